@@ -0,0 +1,222 @@
+// ****************************************************************************
+// MIT License
+//
+// Copyright (c) 2019 Joshua E Bodinet
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// ****************************************************************************
+
+
+// Microbenchmark: tracking queued audio buffers in a std::map keyed by buffer
+// name (the old Audiblizer scheme) vs. a FIFO RingBuffer matched by queue order.
+//
+// Build & run (from this directory):
+//     c++ -std=c++14 -O2 -I../OpenALTest AudioBufferTrackingBenchmark.cpp -o AudioBufferTrackingBenchmark
+//     ./AudioBufferTrackingBenchmark
+
+#include <chrono>
+#include <cstdio>
+#include <cstdint>
+#include <cstdlib>
+#include <map>
+#include <new>
+#include <vector>
+
+#include "RingBuffer.h"
+
+// count every heap allocation made while the benchmark runs
+static uint64_t numAllocations = 0;
+
+void* operator new(size_t size)
+{
+    numAllocations++;
+    
+    void *ptr = malloc(size);
+    if(ptr == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+    
+    return ptr;
+}
+
+void operator delete(void *ptr) noexcept
+{
+    free(ptr);
+}
+
+void operator delete(void *ptr, size_t size) noexcept
+{
+    free(ptr);
+}
+
+class BufferRecord
+{
+public:
+    BufferRecord() : buffer(0), data(nullptr), durationMilliseconds(0), durationSeconds(0) {}
+    BufferRecord(uint32_t name, void *dataArg, uint64_t ms, double seconds) : buffer(name), data(dataArg), durationMilliseconds(ms), durationSeconds(seconds) {}
+    
+    uint32_t buffer;
+    void    *data;
+    uint64_t durationMilliseconds;
+    double   durationSeconds;
+};
+
+class Result
+{
+public:
+    double   nanosecondsPerChunk;
+    uint64_t allocations;
+};
+
+// Keeps 'queueDepth' chunks queued while completing and re-queueing 'batchSize' chunks at a time,
+// just as QueueAudio() / ProcessUnqueueableBuffers() do during steady-state playback
+static Result RunMap(uint32_t queueDepth, uint32_t batchSize, uint64_t numChunks)
+{
+    std::map<uint32_t, BufferRecord> bufferMap;
+    std::vector<uint32_t> processed(batchSize);
+    uint32_t nextName = 1;
+    uint32_t oldestName = 1;
+    uint64_t durationMilliseconds = 0;
+    
+    for(uint32_t i = 0; i < queueDepth; i++, nextName++)
+    {
+        bufferMap.insert(std::make_pair(nextName, BufferRecord(nextName, nullptr, 16, 0.0166833)));
+    }
+    
+    uint64_t allocationsBefore = numAllocations;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    
+    for(uint64_t n = 0; n < numChunks; n += batchSize)
+    {
+        for(uint32_t i = 0; i < batchSize; i++)
+        {
+            processed[i] = oldestName++;
+        }
+        
+        for(uint32_t i = 0; i < batchSize; i++)
+        {
+            std::map<uint32_t, BufferRecord>::iterator iter = bufferMap.find(processed[i]);
+            if(iter != bufferMap.end())
+            {
+                durationMilliseconds += iter->second.durationMilliseconds;
+                bufferMap.erase(iter);
+            }
+        }
+        
+        for(uint32_t i = 0; i < batchSize; i++, nextName++)
+        {
+            bufferMap.insert(std::make_pair(nextName, BufferRecord(nextName, nullptr, 16, 0.0166833)));
+        }
+    }
+    
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    
+    Result result;
+    result.nanosecondsPerChunk = elapsed.count() / numChunks;
+    result.allocations = numAllocations - allocationsBefore;
+    
+    // consume the accumulated duration so that the completion work cannot be optimized away
+    if(durationMilliseconds == 0)
+    {
+        printf("ERROR: no buffers were completed!!!\n");
+    }
+    
+    return result;
+}
+
+static Result RunRing(uint32_t queueDepth, uint32_t batchSize, uint64_t numChunks)
+{
+    RingBuffer<BufferRecord> bufferRing;
+    std::vector<uint32_t> processed(batchSize);
+    uint32_t nextName = 1;
+    uint32_t oldestName = 1;
+    uint64_t durationMilliseconds = 0;
+    
+    bufferRing.Allocate(queueDepth);
+    
+    for(uint32_t i = 0; i < queueDepth; i++, nextName++)
+    {
+        bufferRing.Push(BufferRecord(nextName, nullptr, 16, 0.0166833));
+    }
+    
+    uint64_t allocationsBefore = numAllocations;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    
+    for(uint64_t n = 0; n < numChunks; n += batchSize)
+    {
+        for(uint32_t i = 0; i < batchSize; i++)
+        {
+            processed[i] = oldestName++;
+        }
+        
+        for(uint32_t i = 0; i < batchSize; i++)
+        {
+            if(!bufferRing.Empty() && bufferRing.Front().buffer == processed[i])
+            {
+                durationMilliseconds += bufferRing.Front().durationMilliseconds;
+                bufferRing.PopFront();
+            }
+        }
+        
+        for(uint32_t i = 0; i < batchSize; i++, nextName++)
+        {
+            bufferRing.Push(BufferRecord(nextName, nullptr, 16, 0.0166833));
+        }
+    }
+    
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    
+    Result result;
+    result.nanosecondsPerChunk = elapsed.count() / numChunks;
+    result.allocations = numAllocations - allocationsBefore;
+    
+    // consume the accumulated duration so that the completion work cannot be optimized away
+    if(durationMilliseconds == 0)
+    {
+        printf("ERROR: no buffers were completed!!!\n");
+    }
+    
+    return result;
+}
+
+int main(int argc, const char * argv[])
+{
+    const uint32_t queueDepths[] = { 240, 10000, 50000, 200000 };
+    const uint32_t batchSize = 4;
+    const uint64_t numChunks = 4000000;
+    
+    printf("%12s %18s %14s %18s %14s %8s\n", "queue depth", "map ns/chunk", "map allocs", "ring ns/chunk", "ring allocs", "speedup");
+    
+    for(uint32_t i = 0; i < sizeof(queueDepths) / sizeof(queueDepths[0]); i++)
+    {
+        Result mapResult = RunMap(queueDepths[i], batchSize, numChunks);
+        Result ringResult = RunRing(queueDepths[i], batchSize, numChunks);
+        
+        printf("%12u %18.2f %14llu %18.2f %14llu %7.1fx\n",
+               queueDepths[i],
+               mapResult.nanosecondsPerChunk,
+               (unsigned long long)mapResult.allocations,
+               ringResult.nanosecondsPerChunk,
+               (unsigned long long)ringResult.allocations,
+               mapResult.nanosecondsPerChunk / ringResult.nanosecondsPerChunk);
+    }
+    
+    return 0;
+}
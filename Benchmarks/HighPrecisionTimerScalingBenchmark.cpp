@@ -0,0 +1,348 @@
+// ****************************************************************************
+// MIT License
+//
+// Copyright (c) 2019 Joshua E Bodinet
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// ****************************************************************************
+
+// Scaling benchmark: HighPrecisionTimer w/ 10 to 10,000 delegates, on the heap vs. the timing
+// wheel schedule. Half of the delegates stand in for VideoTimerDelegates (30 and 60fps, at exact
+// rational periods) and half for event-driven Audiblizers (a 10ms sweep), all out of phase w/
+// one another, as they would be for that many independent playback sessions.
+//
+// Three passes for each:
+//   schedule -- the schedule alone (a std heap vs. a TimerWheel), expiring each deadline and
+//               putting the next one back in, which is all that the backend is ever asked to do
+//   stepped  -- the timer runs on a VirtualClock, which is moved straight to each deadline, so
+//               the time per fire is the cost of the whole fire path (w/o any waiting on time)
+//   realtime -- the timer thread runs for real, reporting how late delegates were fired, and how
+//               much of the thread's time went to actual work (i.e. neither asleep nor spinning
+//               out a wait), along w/ the process's CPU use as a whole
+//
+// Build & run (from this directory):
+//     c++ -std=c++14 -O2 -I../OpenALTest HighPrecisionTimerScalingBenchmark.cpp ../OpenALTest/HighPrecisionTimer.cpp -o HighPrecisionTimerScalingBenchmark -lpthread
+//     ./HighPrecisionTimerScalingBenchmark [realtime seconds]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdint>
+#include <cstdlib>
+#include <ctime>
+#include <algorithm>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "HighPrecisionTimer.h"
+#include "TimerWheel.h"
+
+class BenchmarkDelegate : public HighPrecisionTimer::Delegate
+{
+public:
+    BenchmarkDelegate(uint64_t n, uint64_t ts) : numerator(n), timeScale(ts), pings(0) {}
+    
+    virtual void TimerPing() { pings++; }
+    virtual double TimerPeriod() { return numerator / (double)timeScale; }
+    virtual bool TimerPeriodExact(uint64_t &n, uint64_t &ts) { n = numerator; ts = timeScale; return true; }
+    virtual bool FireOnce() { return false; }
+    
+    uint64_t numerator;
+    uint64_t timeScale;
+    std::atomic<uint64_t> pings;
+};
+
+typedef std::vector<std::shared_ptr<BenchmarkDelegate>> BenchmarkDelegates;
+
+class Result
+{
+public:
+    Result() : fires(0), nanosecondsPerFire(0), averageLatenessMicroseconds(0), p99LatenessMicroseconds(0), maxLatenessMicroseconds(0), busyPercent(0), cpuPercent(0) {}
+    
+    uint64_t fires;
+    double   nanosecondsPerFire;          // schedule, stepped
+    double   averageLatenessMicroseconds; // realtime
+    double   p99LatenessMicroseconds;     // realtime, of the worst delegate
+    double   maxLatenessMicroseconds;     // realtime
+    double   busyPercent;                 // realtime, of the timer thread's time
+    double   cpuPercent;                  // realtime, of one core
+};
+
+static BenchmarkDelegates CreateDelegates(uint32_t numDelegates)
+{
+    BenchmarkDelegates delegates;
+    
+    for(uint32_t i = 0; i < numDelegates; i++)
+    {
+        switch(i % 4)
+        {
+            case 0:  delegates.push_back(std::make_shared<BenchmarkDelegate>(1001, 30000)); break;
+            case 1:  delegates.push_back(std::make_shared<BenchmarkDelegate>(1001, 60000)); break;
+            default: delegates.push_back(std::make_shared<BenchmarkDelegate>(1, 100)); break;
+        }
+    }
+    
+    return delegates;
+}
+
+// spreads the delegates evenly over their periods, as of 'now'
+static void Stagger(BenchmarkDelegates &delegates, const Clock::TimePoint &now)
+{
+    for(size_t i = 0; i < delegates.size(); i++)
+    {
+        double phase = delegates[i]->TimerPeriod() * ((i * 2654435761ULL) % 1000) / 1000.0;
+        delegates[i]->LastPing(now - std::chrono::duration_cast<Clock::Duration>(std::chrono::duration<double>(phase)));
+    }
+}
+
+class HeapEntry
+{
+public:
+    HeapEntry(int64_t d, uint32_t i) : deadline(d), index(i) {}
+    
+    // std::push_heap() et al build a max-heap, so order by later deadline to get a min-heap
+    bool operator<(const HeapEntry &rhs) const { return deadline > rhs.deadline; }
+    
+    int64_t  deadline;
+    uint32_t index;
+};
+
+// NOTE: times are integer nanoseconds, and every delegate's period is rounded to a whole one, as only
+//       the cost of keeping deadlines in order is of interest here
+static Result RunSchedule(HighPrecisionTimer::ScheduleBackend backend, uint32_t numDelegates, double seconds)
+{
+    BenchmarkDelegates delegates = CreateDelegates(numDelegates);
+    std::vector<int64_t> periods(numDelegates);
+    std::vector<HeapEntry> heap;
+    TimerWheel<uint32_t> wheel;
+    int64_t now = 1000000000;
+    int64_t end = now + (int64_t)(seconds * 1000000000.0);
+    int64_t deadline = 0;
+    uint32_t index = 0;
+    Result result;
+    
+    heap.reserve(numDelegates);
+    wheel.Clear(now);
+    wheel.Reserve(numDelegates);
+    
+    for(uint32_t i = 0; i < numDelegates; i++)
+    {
+        periods[i] = (int64_t)(delegates[i]->TimerPeriod() * 1000000000.0);
+        
+        deadline = now + (periods[i] * ((i * 2654435761ULL) % 1000)) / 1000;
+        if(backend == HighPrecisionTimer::ScheduleBackend_Wheel)
+        {
+            wheel.Insert(deadline, i);
+        }
+        else
+        {
+            heap.push_back(HeapEntry(deadline, i));
+            std::push_heap(heap.begin(), heap.end());
+        }
+    }
+    
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    
+    while(now < end)
+    {
+        if(backend == HighPrecisionTimer::ScheduleBackend_Wheel)
+        {
+            while(wheel.PopDue(now, deadline, index))
+            {
+                wheel.Insert(deadline + periods[index], index);
+                result.fires++;
+            }
+            
+            wheel.NextDeadline(now);
+        }
+        else
+        {
+            while(heap.front().deadline <= now)
+            {
+                std::pop_heap(heap.begin(), heap.end());
+                heap.back().deadline += periods[heap.back().index];
+                std::push_heap(heap.begin(), heap.end());
+                result.fires++;
+            }
+            
+            now = heap.front().deadline;
+        }
+    }
+    
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    
+    result.nanosecondsPerFire = result.fires > 0 ? elapsed.count() / result.fires : 0;
+    
+    return result;
+}
+
+static Result RunStepped(HighPrecisionTimer::ScheduleBackend backend, uint32_t numDelegates, double seconds)
+{
+    std::shared_ptr<VirtualClock> virtualClock = std::make_shared<VirtualClock>();
+    HighPrecisionTimer timer(virtualClock);
+    BenchmarkDelegates delegates = CreateDelegates(numDelegates);
+    Clock::TimePoint nextDeadline;
+    Result result;
+    
+    timer.SetDumpStatisticsOnStop(false);
+    timer.SetScheduleBackend(backend);
+    
+    for(size_t i = 0; i < delegates.size(); i++)
+    {
+        timer.AddDelegate(delegates[i]);
+    }
+    
+    virtualClock->Set(Clock::TimePoint(std::chrono::seconds(1)));
+    Stagger(delegates, virtualClock->Now());
+    
+    // the first Step() builds the schedule, which is left out of the timing
+    timer.Step(nextDeadline);
+    
+    Clock::TimePoint end = virtualClock->Now() + std::chrono::duration_cast<Clock::Duration>(std::chrono::duration<double>(seconds));
+    uint64_t firesBefore = timer.GetStatistics().fires;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    
+    while(nextDeadline < end)
+    {
+        virtualClock->Set(nextDeadline);
+        
+        if(!timer.Step(nextDeadline))
+        {
+            break;
+        }
+    }
+    
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    
+    result.fires = timer.GetStatistics().fires - firesBefore;
+    result.nanosecondsPerFire = result.fires > 0 ? elapsed.count() / result.fires : 0;
+    
+    timer.RemoveAllDelegates();
+    
+    return result;
+}
+
+static Result RunRealtime(HighPrecisionTimer::ScheduleBackend backend, uint32_t numDelegates, double seconds)
+{
+    HighPrecisionTimer timer;
+    BenchmarkDelegates delegates = CreateDelegates(numDelegates);
+    Result result;
+    
+    timer.SetDumpStatisticsOnStop(false);
+    timer.SetScheduleBackend(backend);
+    
+    for(size_t i = 0; i < delegates.size(); i++)
+    {
+        timer.AddDelegate(delegates[i]);
+    }
+    
+    std::clock_t cpuStart = std::clock();
+    
+    if(!timer.Start())
+    {
+        printf("ERROR: Failed to start timer!!!\n");
+        return result;
+    }
+    
+    // NOTE: Start() puts every delegate in phase, so they are staggered once it has
+    Stagger(delegates, timer.GetClock()->Now());
+    
+    std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+    timer.Stop();
+    
+    std::clock_t cpuEnd = std::clock();
+    HighPrecisionTimer::TimerStatistics statistics = timer.GetStatistics();
+    
+    for(size_t i = 0; i < delegates.size(); i++)
+    {
+        HighPrecisionTimer::DelegateStatistics delegateStatistics = timer.GetDelegateStatistics(delegates[i]);
+        result.p99LatenessMicroseconds = std::max(result.p99LatenessMicroseconds, delegateStatistics.lateness.p99Nanoseconds / 1000.0);
+    }
+    
+    result.fires = statistics.fires;
+    result.averageLatenessMicroseconds = statistics.fires > 0 ? statistics.totalLatenessNanoseconds / 1000.0 / statistics.fires : 0;
+    result.maxLatenessMicroseconds = statistics.maxLatenessNanoseconds / 1000.0;
+    if(statistics.runNanoseconds > 0)
+    {
+        result.busyPercent = 100.0 * (statistics.runNanoseconds - statistics.sleepNanoseconds - statistics.spinNanoseconds) / statistics.runNanoseconds;
+    }
+    result.cpuPercent = 100.0 * ((cpuEnd - cpuStart) / (double)CLOCKS_PER_SEC) / seconds;
+    
+    timer.RemoveAllDelegates();
+    
+    return result;
+}
+
+int main(int argc, const char * argv[])
+{
+    const uint32_t numDelegates[] = { 10, 100, 1000, 10000 };
+    const HighPrecisionTimer::ScheduleBackend backends[] = { HighPrecisionTimer::ScheduleBackend_Heap, HighPrecisionTimer::ScheduleBackend_Wheel };
+    const char *backendNames[] = { "heap", "wheel" };
+    const double steppedSeconds = 10.0;
+    const double realtimeSeconds = argc > 1 ? atof(argv[1]) : 3.0;
+    
+    printf("schedule (%.0f virtual sec)\n", steppedSeconds);
+    printf("%10s %8s %12s %12s\n", "delegates", "backend", "fires", "ns/fire");
+    
+    for(uint32_t i = 0; i < sizeof(numDelegates) / sizeof(numDelegates[0]); i++)
+    {
+        for(uint32_t j = 0; j < sizeof(backends) / sizeof(backends[0]); j++)
+        {
+            Result result = RunSchedule(backends[j], numDelegates[i], steppedSeconds);
+            
+            printf("%10u %8s %12llu %12.1f\n", numDelegates[i], backendNames[j], (unsigned long long)result.fires, result.nanosecondsPerFire);
+        }
+    }
+    
+    printf("\nstepped (%.0f virtual sec)\n", steppedSeconds);
+    printf("%10s %8s %12s %12s\n", "delegates", "backend", "fires", "ns/fire");
+    
+    for(uint32_t i = 0; i < sizeof(numDelegates) / sizeof(numDelegates[0]); i++)
+    {
+        for(uint32_t j = 0; j < sizeof(backends) / sizeof(backends[0]); j++)
+        {
+            Result result = RunStepped(backends[j], numDelegates[i], steppedSeconds);
+            
+            printf("%10u %8s %12llu %12.1f\n", numDelegates[i], backendNames[j], (unsigned long long)result.fires, result.nanosecondsPerFire);
+        }
+    }
+    
+    printf("\nrealtime (%.1f sec)\n", realtimeSeconds);
+    printf("%10s %8s %12s %14s %14s %14s %8s %8s\n", "delegates", "backend", "fires", "avg late usec", "p99 late usec", "max late usec", "busy %", "cpu %");
+    
+    for(uint32_t i = 0; i < sizeof(numDelegates) / sizeof(numDelegates[0]); i++)
+    {
+        for(uint32_t j = 0; j < sizeof(backends) / sizeof(backends[0]); j++)
+        {
+            Result result = RunRealtime(backends[j], numDelegates[i], realtimeSeconds);
+            
+            printf("%10u %8s %12llu %14.2f %14.2f %14.2f %8.1f %8.1f\n",
+                   numDelegates[i],
+                   backendNames[j],
+                   (unsigned long long)result.fires,
+                   result.averageLatenessMicroseconds,
+                   result.p99LatenessMicroseconds,
+                   result.maxLatenessMicroseconds,
+                   result.busyPercent,
+                   result.cpuPercent);
+        }
+    }
+    
+    return 0;
+}
@@ -0,0 +1,100 @@
+// ****************************************************************************
+// MIT License
+//
+// Copyright (c) 2019 Joshua E Bodinet
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// ****************************************************************************
+
+#include "AllocationTracker.h"
+
+#include <cstdlib>
+#include <new>
+
+#if AUDIBLIZER_TRACK_ALLOCATIONS
+
+static std::atomic<uint64_t> allocationCount(0);
+static thread_local bool     allocationTracking = false;
+
+void AllocationTracker::Begin()
+{
+    allocationTracking = true;
+}
+
+void AllocationTracker::End()
+{
+    allocationTracking = false;
+}
+
+uint64_t AllocationTracker::Count()
+{
+    return allocationCount.load();
+}
+
+static void* TrackedAllocation(size_t size)
+{
+    if(allocationTracking)
+    {
+        allocationCount++;
+    }
+    
+    return malloc(size != 0 ? size : 1);
+}
+
+// NOTE: these replace the global operators for the whole process
+// ------------------------------------------------------------------
+void* operator new(size_t size)
+{
+    void *ptr = TrackedAllocation(size);
+    if(ptr == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+    
+    return ptr;
+}
+
+void* operator new[](size_t size)
+{
+    void *ptr = TrackedAllocation(size);
+    if(ptr == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+    
+    return ptr;
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept { return TrackedAllocation(size); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { return TrackedAllocation(size); }
+
+void operator delete(void *ptr) noexcept { free(ptr); }
+void operator delete[](void *ptr) noexcept { free(ptr); }
+void operator delete(void *ptr, size_t) noexcept { free(ptr); }
+void operator delete[](void *ptr, size_t) noexcept { free(ptr); }
+void operator delete(void *ptr, const std::nothrow_t&) noexcept { free(ptr); }
+void operator delete[](void *ptr, const std::nothrow_t&) noexcept { free(ptr); }
+
+#else
+
+void AllocationTracker::Begin() {}
+void AllocationTracker::End() {}
+uint64_t AllocationTracker::Count() { return 0; }
+
+#endif
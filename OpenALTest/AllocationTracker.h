@@ -0,0 +1,51 @@
+// ****************************************************************************
+// MIT License
+//
+// Copyright (c) 2019 Joshua E Bodinet
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// ****************************************************************************
+
+#ifndef AllocationTracker_h
+#define AllocationTracker_h
+
+#include <atomic>
+#include <cstdint>
+
+// Build w/ AUDIBLIZER_TRACK_ALLOCATIONS=1 to replace the global operator new with one that counts
+// every allocation made by a thread while it is between Begin() and End(). Otherwise everything
+// here is a no-op, and Count() is always 0
+#ifndef AUDIBLIZER_TRACK_ALLOCATIONS
+#define AUDIBLIZER_TRACK_ALLOCATIONS 0
+#endif
+
+class AllocationTracker
+{
+public:
+    static bool Enabled() { return AUDIBLIZER_TRACK_ALLOCATIONS != 0; }
+    
+    // mark the start / end of a region of code on the current thread that should not allocate
+    static void Begin();
+    static void End();
+    
+    // total number of allocations made, by all threads, from within a Begin() / End() region
+    static uint64_t Count();
+};
+
+#endif /* AllocationTracker_h */
@@ -31,14 +31,39 @@ Audiblizer::Audiblizer() :
     audioChunkCompletionListener(nullptr),
     processedBuffers(nullptr),
     processBuffersCount(0),
-    audioBufferMapDurationMilliseconds(0),
-    initialized(false)
+    queuedChunkCount(0),
+    queuedDurationMilliseconds(0),
+    maxQueuedChunks(0),
+    submissionFormat(AudioFormat_None),
+    submissionSampleRate(0),
+    initialized(false),
+    eventDriven(false),
+    alEventControlSOFT(nullptr),
+    alEventCallbackSOFT(nullptr),
+    playbackMode(PlaybackMode_Queued),
+    alBufferCallbackSOFT(nullptr),
+    callbackBuffer(0),
+    callbackFormat(AudioFormat_None),
+    callbackSampleRate(0),
+    callbackSilence(0),
+    callbackBufferDurationSeconds(0),
+    callbackBytesCompleted(0),
+    positionFramesCompleted(0),
+    positionLastSamples(0),
+    positionSampleRate(0),
+    alGetSourcei64vSOFT(nullptr),
+    loopbackDevice(false),
+    loopbackSampleRate(0),
+    alcRenderSamplesSOFT(nullptr)
 {
     
 }
 
 Audiblizer::~Audiblizer()
 {
+    // NOTE: must occur prior to taking down the source, and must NOT occur while holding 'mutex'
+    DisableEvents();
+    
     if(source != 0)
     {
         Stop();
@@ -47,6 +72,14 @@ Audiblizer::~Audiblizer()
         source = 0;
     }
     
+    if(callbackBuffer != 0)
+    {
+        alDeleteBuffers(1, &callbackBuffer);
+        callbackBuffer = 0;
+    }
+    
+    audioBufferNamePool.Destroy();
+    
     if(context != nullptr)
     {
         alcMakeContextCurrent(NULL);
@@ -72,12 +105,15 @@ Audiblizer::~Audiblizer()
 void Audiblizer::PrepareForDestruction()
 {
     Stop();
+    
+    std::lock_guard<std::mutex> dispatchLock(dispatchMutex);
     audioChunkCompletionListener = nullptr;
 }
 
-bool Audiblizer::Initialize()
+bool Audiblizer::Initialize(const Configuration &configuration)
 {
     std::lock_guard<std::mutex> lock(mutex);
+    std::lock_guard<std::mutex> alLock(alMutex);
     
     if(initialized)
     {
@@ -88,18 +124,28 @@ bool Audiblizer::Initialize()
     ALCenum error = AL_NO_ERROR;
     bool retVal = false;
     
-    // create device
+    // create device and context
     // ------------------------------------------------------------
-    device = alcOpenDevice(NULL);
-    if (!device)
+    if(configuration.loopback)
     {
-        printf("ERROR: OpenDevice!!!\n");
-        goto CleanUp;
+        if(!OpenLoopbackDevice(configuration.loopbackSampleRate))
+        {
+            printf("ERROR: OpenLoopbackDevice!!!\n");
+            goto CleanUp;
+        }
+    }
+    else
+    {
+        device = alcOpenDevice(NULL);
+        if (!device)
+        {
+            printf("ERROR: OpenDevice!!!\n");
+            goto CleanUp;
+        }
+        
+        context = alcCreateContext(device, NULL);
     }
     
-    // create context
-    // -------------------------------------------------------------
-    context = alcCreateContext(device, NULL);
     if (!alcMakeContextCurrent(context))
     {
         printf("ERROR: CreateContext!!!\n");
@@ -158,9 +204,10 @@ bool Audiblizer::Initialize()
         goto CleanUp;
     }
     
-    // init processedBuffers to be 1
+    // size processedBuffers and the completion vectors to hold every chunk that can be queued at once, so that
+    // reclaiming audio never has to allocate (no more buffers can ever be processed than can be queued)
     // --------------------------------------------------------------
-    processBuffersCount = 1;
+    processBuffersCount = configuration.maxQueuedChunks;
     processedBuffers = (ALuint*)malloc(sizeof(ALuint) * processBuffersCount);
     if(processedBuffers == nullptr)
     {
@@ -168,6 +215,75 @@ bool Audiblizer::Initialize()
         goto CleanUp;
     }
     
+    pendingCompletions.reserve(configuration.maxQueuedChunks);
+    dispatchCompletions.reserve(configuration.maxQueuedChunks);
+    
+    // source latency lets PlaybackPosition() report what is being heard rather than what is being mixed
+    // --------------------------------------------------------------
+    if(alIsExtensionPresent("AL_SOFT_source_latency"))
+    {
+        alGetSourcei64vSOFT = (LPALGETSOURCEI64VSOFT) alGetProcAddress("alGetSourcei64vSOFT");
+    }
+    
+    // allocate the ring that tracks the queued buffers
+    // --------------------------------------------------------------
+    if(!audioBufferRing.Allocate(configuration.maxQueuedChunks))
+    {
+        printf("ERROR: Allocate Buffer Ring!!!\n");
+        error = AL_OUT_OF_MEMORY;
+        goto CleanUp;
+    }
+    
+    // allocate the ring that hands submitted audio off to the timer thread
+    // --------------------------------------------------------------
+    if(!submissionRing.Allocate(configuration.maxQueuedChunks))
+    {
+        printf("ERROR: Allocate Submission Ring!!!\n");
+        error = AL_OUT_OF_MEMORY;
+        goto CleanUp;
+    }
+    
+    maxQueuedChunks = configuration.maxQueuedChunks;
+    
+    // figure out the playback mode (the callback buffer itself is set up by the first QueueAudio(),
+    // once the format and sample rate of the audio are known)
+    // --------------------------------------------------------------
+    playbackMode = PlaybackMode_Queued;
+    if(configuration.playbackMode == PlaybackMode_Callback && alIsExtensionPresent("AL_SOFT_callback_buffer"))
+    {
+        alBufferCallbackSOFT = (LPALBUFFERCALLBACKSOFT) alGetProcAddress("alBufferCallbackSOFT");
+        if(alBufferCallbackSOFT != nullptr)
+        {
+            playbackMode = PlaybackMode_Callback;
+            callbackBufferDurationSeconds = configuration.callbackBufferDurationSeconds;
+        }
+    }
+    
+    if(playbackMode == PlaybackMode_Queued)
+    {
+        // pre-generate enough buffer names to cover the expected queue depth
+        // --------------------------------------------------------------
+        if(!audioBufferNamePool.Reserve(configuration.maxQueuedChunks))
+        {
+            printf("ERROR: Reserve Buffer Names!!!\n");
+            error = AL_OUT_OF_MEMORY;
+            goto CleanUp;
+        }
+        
+        // a single drain never uploads more chunks than can be queued at once
+        submissionBuffers.resize(configuration.maxQueuedChunks);
+        
+        // reclaim buffers from buffer-completed events if we are able to (otherwise we poll via TimerPing())
+        // NOTE: a callback buffer never completes, so there are no events to be had in PlaybackMode_Callback.
+        //       Nor do we use events on a loopback device, as they arrive on OpenAL's own event thread,
+        //       which would make an otherwise deterministic render non-deterministic
+        // --------------------------------------------------------------
+        if(configuration.useEvents && !loopbackDevice)
+        {
+            eventDriven = EnableEvents();
+        }
+    }
+    
     retVal = true;
     initialized = true;
 CleanUp:
@@ -179,6 +295,10 @@ CleanUp:
             source = 0;
         }
         
+        audioBufferNamePool.Destroy();
+        audioBufferRing.Release();
+        submissionRing.Release();
+        
         if(context != nullptr)
         {
             alcMakeContextCurrent(NULL);
@@ -206,25 +326,30 @@ CleanUp:
 
 void Audiblizer::SetBuffersCompletedListener(std::shared_ptr<AudioChunkCompletionListener> listener)
 {
+    std::lock_guard<std::mutex> dispatchLock(dispatchMutex);
     audioChunkCompletionListener = listener;
 }
 
 bool Audiblizer::QueueAudio(const AudioChunkVector &audioChunks)
 {
-    std::lock_guard<std::mutex> lock(mutex);
+    // NOTE: deliberately does NOT take 'mutex' (see submissionRing)
     
     if(!initialized)
     {
         return false;
     }
     
-    ALCenum error = AL_NO_ERROR;
-    bool retVal = true;
-    ALuint buffer = 0;
-    ALint sourceState = 0;
-    AudioBufferMapInsertionPair audioBufferMapInsertionPair;
-    uint64_t audioChunkDurationMilliseconds;
-    double   audioChunkDurationSeconds;
+    // the rings are fixed-capacity, so refuse the whole vector up front if it would not fit
+    if(queuedChunkCount.load() + audioChunks.size() > maxQueuedChunks)
+    {
+        return false;
+    }
+    
+    // validate all of the chunks up front, so that we either submit all of them or none of them
+    // NOTE: the format and rate are only latched once the whole vector has passed, so that a vector that is
+    //       refused leaves the callback buffer free to take whatever is submitted next
+    AudioFormat format = submissionFormat;
+    uint32_t    sampleRate = submissionSampleRate;
     
     for(uint32_t i = 0; i < audioChunks.size(); i++)
     {
@@ -232,119 +357,106 @@ bool Audiblizer::QueueAudio(const AudioChunkVector &audioChunks)
         if(audioChunks[i].format == AudioFormat_None ||
            audioChunks[i].buffer == nullptr ||
            audioChunks[i].bufferSize == 0 ||
-           audioChunks[i].sampleRate == 0)
-        {
-            retVal = false;
-            goto CleanUp;
-        }
-        
-        // find the duration of this audio chunk
-        // --------------------------------------------------------------
-        audioChunkDurationSeconds = (audioChunks[i].bufferSize) / (double)(AudioFormatFrameByteLength(audioChunks[i].format) * audioChunks[i].sampleRate);
-        audioChunkDurationMilliseconds = (audioChunks[i].bufferSize * 1000.0) / (AudioFormatFrameByteLength(audioChunks[i].format) * audioChunks[i].sampleRate);
-        
-        // generate and initialize sound buffer
-        // --------------------------------------------------------------
-        alGenBuffers((ALuint)1, &buffer);
-        error = alGetError();
-        if (error != AL_NO_ERROR)
+           audioChunks[i].sampleRate == 0 ||
+           audioChunks[i].bufferSize % AudioFormatFrameByteLength(audioChunks[i].format) != 0)
         {
-            retVal = false;
-            goto CleanUp;
+            return false;
         }
         
-        alBufferData(buffer, OpenALAudioFormat(audioChunks[i].format), audioChunks[i].buffer, (ALsizei)audioChunks[i].bufferSize, (ALsizei)audioChunks[i].sampleRate);
-        error = alGetError();
-        if (error != AL_NO_ERROR)
+        // the callback buffer is bound to a single format and sample rate, which is that of the first audio ever submitted
+        if(playbackMode == PlaybackMode_Callback)
         {
-            retVal = false;
-            goto CleanUp;
+            if(format == AudioFormat_None)
+            {
+                format = audioChunks[i].format;
+                sampleRate = audioChunks[i].sampleRate;
+            }
+            
+            if(audioChunks[i].format != format || audioChunks[i].sampleRate != sampleRate)
+            {
+                return false;
+            }
+            
+            // a chunk is only ever written to the callback ring whole, so one that is larger than the entire ring would
+            // hold up the submission ring (and thus playback) forever
+            if(audioChunks[i].bufferSize > CallbackByteRingCapacity(audioChunks[i].format, audioChunks[i].sampleRate))
+            {
+                printf("ERROR: Audio chunk is larger than the entire callback buffer (see callbackBufferDurationSeconds)!!!\n");
+                return false;
+            }
         }
+    }
+    
+    submissionFormat = format;
+    submissionSampleRate = sampleRate;
+    
+    for(uint32_t i = 0; i < audioChunks.size(); i++)
+    {
+        AudioSubmission audioSubmission;
         
-        // Queue sound buffer onto source
+        // find the duration of this audio chunk
         // --------------------------------------------------------------
-        alSourceQueueBuffers(source, 1, &buffer);
-        error = alGetError();
-        if (error != AL_NO_ERROR)
-        {
-            retVal = false;
-            goto CleanUp;
-        }
+        audioSubmission.audioChunk = audioChunks[i];
+        audioSubmission.audioChunkFrames = audioChunks[i].bufferSize / AudioFormatFrameByteLength(audioChunks[i].format);
+        audioSubmission.audioChunkDurationSeconds = (audioChunks[i].bufferSize) / (double)(AudioFormatFrameByteLength(audioChunks[i].format) * audioChunks[i].sampleRate);
+        audioSubmission.audioChunkDurationMilliseconds = (audioChunks[i].bufferSize * 1000.0) / (AudioFormatFrameByteLength(audioChunks[i].format) * audioChunks[i].sampleRate);
         
-        // insert buffer into audioBufferMap
-        // --------------------------------------------------------------
-        audioBufferMapInsertionPair = audioBufferMap.insert(AudioBufferMapPair(buffer, AudioBufferMapValue(audioChunks[i].buffer, audioChunkDurationMilliseconds, audioChunkDurationSeconds)));
-        if(!audioBufferMapInsertionPair.second)
-        {
-            retVal = false;
-            goto CleanUp;
-        }
+        // count the chunk ***before*** handing it off, as the timer thread may complete it right away
+        queuedChunkCount += 1;
+        queuedDurationMilliseconds += audioSubmission.audioChunkDurationMilliseconds;
         
-        audioBufferMapDurationMilliseconds += audioChunkDurationMilliseconds;
-    }
-    
-    // ensure that the source is playing
-    // --------------------------------------------------------------
-    alGetSourcei(source, AL_SOURCE_STATE, &sourceState);
-    error = alGetError();
-    if (error != AL_NO_ERROR)
-    {
-        retVal = false;
-        goto CleanUp;
+        submissionRing.Push(audioSubmission);
     }
     
-    if(sourceState != AL_PLAYING)
+    // TimerPeriod() shortens now that there is audio to pick up, which the timer must be told about
+    if(eventDriven && !audioChunks.empty())
     {
-        alSourcePlay(source);
-        error = alGetError();
-        if (error != AL_NO_ERROR)
-        {
-            retVal = false;
-            goto CleanUp;
-        }
+        ScheduleChanged();
     }
     
-CleanUp:
-    
-    return retVal;
+    return true;
 }
 
 uint32_t Audiblizer::NumBuffersQueued()
 {
-    std::lock_guard<std::mutex> lock(mutex);
-    
     if(!initialized)
     {
-        return false;
-    }
-    
-    ALCenum error = AL_NO_ERROR;
-    ALint numBuffersQueued;
-    
-    alGetSourcei(source, AL_BUFFERS_QUEUED, &numBuffersQueued);
-    if (error != AL_NO_ERROR)
-    {
-        numBuffersQueued = UINT32_MAX;
+        return 0;
     }
     
-    return numBuffersQueued;
+    return queuedChunkCount.load();
 }
 
 double Audiblizer::QueuedAudioDurationSeconds()
 {
-    std::lock_guard<std::mutex> lock(mutex);
-    
     if(!initialized)
     {
         return 0;
     }
     
-    return audioBufferMapDurationMilliseconds / 1000.0;
+    return queuedDurationMilliseconds.load() / 1000.0;
+}
+
+Audiblizer::BufferPoolStatistics Audiblizer::GetBufferPoolStatistics()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    
+    return audioBufferNamePool.Statistics();
+}
+
+Audiblizer::LockStatistics Audiblizer::GetLockStatistics()
+{
+    // NOTE: same order as DispatchCompletions(), which takes 'dispatchMutex' while holding 'mutex'
+    std::lock_guard<std::mutex> lock(mutex);
+    std::lock_guard<std::mutex> dispatchLock(dispatchMutex);
+    
+    return lockStatistics;
 }
 
 bool Audiblizer::Stop()
 {
     std::lock_guard<std::mutex> lock(mutex);
+    std::lock_guard<std::mutex> alLock(alMutex);
     
     if(!initialized)
     {
@@ -352,23 +464,129 @@ bool Audiblizer::Stop()
     }
     
     bool retVal = true;
+    AudioSubmission *audioSubmission = nullptr;
     
     alSourceStop(source);
     
-    // unbind all buffers that are still attached to source
-    alSourcei(source, AL_BUFFER, NULL);
+    // playback starts over from zero
+    positionMutex.lock();
+    positionFramesCompleted = 0;
+    positionLastSamples = 0;
+    if(playbackMode == PlaybackMode_Queued)
+    {
+        positionSampleRate = 0;
+    }
+    positionMutex.unlock();
     
     // -----------
     // TODO - in the event that there is no audioChunkCompletionListener, who destroys any audio data bound to the source?
     // -----------
     
-    // clear out the audioBufferMap
-    audioBufferMap.clear();
-    audioBufferMapDurationMilliseconds = 0;
+    // forget about any audio that was submitted, but that has not yet made it into OpenAL
+    // NOTE: the counts are decremented rather than zeroed, as QueueAudio() may be adding to them right now
+    while((audioSubmission = submissionRing.Front()) != nullptr)
+    {
+        queuedChunkCount -= 1;
+        queuedDurationMilliseconds -= audioSubmission->audioChunkDurationMilliseconds;
+        submissionRing.PopFront();
+    }
+    
+    for(size_t i = 0; i < audioBufferRing.Size(); i++)
+    {
+        queuedChunkCount -= 1;
+        queuedDurationMilliseconds -= audioBufferRing.At(i).audioBufferDurationMilliseconds;
+    }
+    
+    if(playbackMode == PlaybackMode_Callback)
+    {
+        // the mixer no longer pulls from the ring once the source is stopped, and the callback buffer
+        // stays bound to the source, so all there is to do is forget about the audio that was pending
+        callbackByteRing.Reset();
+        callbackBytesCompleted = 0;
+        
+        audioBufferRing.Clear();
+        
+        return retVal;
+    }
+    
+    // unbind all buffers that are still attached to source
+    alSourcei(source, AL_BUFFER, NULL);
+    
+    // as the source no longer references any buffers, all of the buffer names go back into the pool
+    for(size_t i = 0; i < audioBufferRing.Size(); i++)
+    {
+        audioBufferNamePool.Release(&audioBufferRing.At(i).buffer, 1);
+    }
+    
+    // clear out the audioBufferRing
+    audioBufferRing.Clear();
     
     return retVal;
 }
 
+bool Audiblizer::EnableEvents()
+{
+    if(!alIsExtensionPresent("AL_SOFT_events"))
+    {
+        return false;
+    }
+    
+    alEventControlSOFT = (LPALEVENTCONTROLSOFT) alGetProcAddress("alEventControlSOFT");
+    alEventCallbackSOFT = (LPALEVENTCALLBACKSOFT) alGetProcAddress("alEventCallbackSOFT");
+    if(alEventControlSOFT == nullptr || alEventCallbackSOFT == nullptr)
+    {
+        alEventControlSOFT = nullptr;
+        alEventCallbackSOFT = nullptr;
+        return false;
+    }
+    
+    const ALenum eventTypes[] = { AL_EVENT_TYPE_BUFFER_COMPLETED_SOFT };
+    
+    alEventCallbackSOFT(EventCallback, this);
+    alEventControlSOFT(1, eventTypes, AL_TRUE);
+    if(alGetError() != AL_NO_ERROR)
+    {
+        alEventCallbackSOFT(nullptr, nullptr);
+        alGetError();
+        
+        alEventControlSOFT = nullptr;
+        alEventCallbackSOFT = nullptr;
+        return false;
+    }
+    
+    return true;
+}
+
+void Audiblizer::DisableEvents()
+{
+    if(!eventDriven)
+    {
+        return;
+    }
+    
+    const ALenum eventTypes[] = { AL_EVENT_TYPE_BUFFER_COMPLETED_SOFT };
+    
+    // OpenAL serializes alEventCallbackSOFT() against the delivery of events, so once
+    // this returns, no EventCallback() is in progress nor will another one occur
+    alEventControlSOFT(1, eventTypes, AL_FALSE);
+    alEventCallbackSOFT(nullptr, nullptr);
+    
+    eventDriven = false;
+}
+
+void Audiblizer::EventCallback(ALenum eventType, ALuint object, ALuint param, ALsizei length, const ALchar *message, void *userParam)
+{
+    Audiblizer *audiblizer = (Audiblizer*) userParam;
+    
+    // NOTE: called on OpenAL's event thread
+    if(audiblizer == nullptr || eventType != AL_EVENT_TYPE_BUFFER_COMPLETED_SOFT || object != audiblizer->source)
+    {
+        return;
+    }
+    
+    audiblizer->ProcessUnqueueableBuffers();
+}
+
 void Audiblizer::TimerPing()
 {
     ProcessUnqueueableBuffers();
@@ -376,7 +594,14 @@ void Audiblizer::TimerPing()
 
 bool Audiblizer::ProcessUnqueueableBuffers()
 {
-    std::lock_guard<std::mutex> lock(mutex);
+    if(playbackMode == PlaybackMode_Callback)
+    {
+        return ProcessConsumedCallbackAudio();
+    }
+    
+    std::unique_lock<std::mutex> lock(mutex);
+    std::unique_lock<std::mutex> alLock(alMutex);
+    std::chrono::steady_clock::time_point lockAcquired = std::chrono::steady_clock::now();
     
     if(!initialized)
     {
@@ -386,7 +611,12 @@ bool Audiblizer::ProcessUnqueueableBuffers()
     bool retVal = true;
     ALCenum error = AL_NO_ERROR;
     ALint numBuffersProcessed = 0;
-    AudioChunkCompletionListener::AudioChunkCompletedVector audioChunksCompleted;
+    
+    // nothing from here until the listener is called should touch the heap
+    AllocationTracker::Begin();
+    
+    // move any newly submitted audio into OpenAL
+    DrainSubmissions(pendingCompletions);
     
     // find out how many buffers have been processed
     alGetSourcei(source, AL_BUFFERS_PROCESSED, &numBuffersProcessed);
@@ -403,31 +633,23 @@ bool Audiblizer::ProcessUnqueueableBuffers()
         goto Exit;
     }
     
-    // ensure that there are enough elements in processedBuffers to get all of the buffers to be unqueued
+    // processedBuffers was sized at Initialize() to hold all of the buffers that can be queued at once, so this can
+    // only ever come into play should OpenAL report more buffers than we queued (in which case any extra are left
+    // for the next pass, rather than growing the array)
     if(numBuffersProcessed > processBuffersCount)
     {
-        if(processedBuffers != nullptr)
-        {
-            free(processedBuffers);
-            processedBuffers = nullptr;
-            
-            processBuffersCount = 0;
-        }
-        
-        processedBuffers = (ALuint*) malloc(sizeof(ALuint) * numBuffersProcessed);
-        if(processedBuffers == nullptr)
-        {
-            retVal = false;
-            goto Exit;
-        }
-        
-        processBuffersCount = numBuffersProcessed;
+        numBuffersProcessed = processBuffersCount;
     }
     
     // unqueue the buffers
+    // NOTE: 'positionMutex' is held until the frames of the unqueued buffers have been accounted for, as
+    //       unqueueing rebases AL_SAMPLE_OFFSET onto the buffers that remain queued
+    positionMutex.lock();
     alSourceUnqueueBuffers(source, numBuffersProcessed, processedBuffers);
+    error = alGetError();
     if (error != AL_NO_ERROR)
     {
+        positionMutex.unlock();
         retVal = false;
         goto Exit;
     }
@@ -435,52 +657,692 @@ bool Audiblizer::ProcessUnqueueableBuffers()
     // handle the unqueued buffers
     for(uint32_t i = 0; i < numBuffersProcessed; i++)
     {
-        AudioBufferMapIterator iter = audioBufferMap.find(processedBuffers[i]);
-        if(iter != audioBufferMap.end())
+        size_t ringIndex = 0;
+        
+        // OpenAL unqueues in queue order, so the processed buffer should always be at the front of the ring.
+        // Should that ever not be the case, fall back to searching the ring for it
+        if(audioBufferRing.Empty() || audioBufferRing.Front().buffer != processedBuffers[i])
         {
-            // if there is a listener, the listener is responsible for freeing this memory,
-            // so insert the dataPtr into the buffersCompleted vector
-            if(audioChunkCompletionListener != nullptr)
+            for(ringIndex = 1; ringIndex < audioBufferRing.Size(); ringIndex++)
             {
-                audioChunksCompleted.push_back(AudioChunkCompletionListener::AudioChunkProperties(iter->second.audioBufferData, iter->second.audioBufferDurationSeconds));
-            }
-            // otherwise WE free() this memory
-            else
-            {
-                if(iter->second.audioBufferData != nullptr)
+                if(audioBufferRing.At(ringIndex).buffer == processedBuffers[i])
                 {
-                    free(iter->second.audioBufferData);
+                    break;
                 }
             }
             
-            // lop off the duration of the unqueued buffer from the total
-            if(audioBufferMapDurationMilliseconds > iter->second.audioBufferDurationMilliseconds)
-            {
-                audioBufferMapDurationMilliseconds -= iter->second.audioBufferDurationMilliseconds;
-            }
-            else
+            if(ringIndex >= audioBufferRing.Size())
             {
-                audioBufferMapDurationMilliseconds = 0;
+                continue;
             }
-                
-            // remove buffer from map
-            audioBufferMap.erase(iter);
+        }
+        
+        positionFramesCompleted += audioBufferRing.At(ringIndex).audioBufferFrames;
+        CompleteAudioBufferRecord(audioBufferRing.At(ringIndex), pendingCompletions);
+        
+        // remove buffer from ring
+        if(ringIndex == 0)
+        {
+            audioBufferRing.PopFront();
+        }
+        else
+        {
+            audioBufferRing.Remove(ringIndex);
         }
     }
     
-    // call the audioChunkCompletion listener
-    if(audioChunkCompletionListener != nullptr)
-    {
-        audioChunkCompletionListener->AudioChunkCompleted(audioChunksCompleted);
-    }
+    positionMutex.unlock();
     
-    // delete the buffers
-    alDeleteBuffers(numBuffersProcessed, processedBuffers);
+    // recycle the buffer names so that QueueAudio() can reuse them
+    audioBufferNamePool.Release(processedBuffers, numBuffersProcessed);
     
 Exit:
+    alLock.unlock();
+    
+    // call the audioChunkCompletion listener (after releasing 'mutex')
+    DispatchCompletions(lock, lockAcquired);
+    
     return retVal;
 }
 
+void Audiblizer::RecordLockHold(const std::chrono::steady_clock::time_point &lockAcquired)
+{
+    // NOTE: 'mutex' is held by the caller
+    uint64_t holdNanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - lockAcquired).count();
+    
+    lockStatistics.acquisitions++;
+    lockStatistics.totalHoldNanoseconds += holdNanoseconds;
+    lockStatistics.maxHoldNanoseconds = std::max(lockStatistics.maxHoldNanoseconds, holdNanoseconds);
+}
+
+void Audiblizer::DispatchCompletions(std::unique_lock<std::mutex> &lock, const std::chrono::steady_clock::time_point &lockAcquired)
+{
+    // NOTE: 'lock' holds 'mutex' upon entry, and no longer does upon return
+    AllocationTracker::End();
+    RecordLockHold(lockAcquired);
+    
+    if(pendingCompletions.empty())
+    {
+        lock.unlock();
+        return;
+    }
+    
+    // hand off from 'mutex' to 'dispatchMutex', so that a completion that is collected later can never be delivered earlier
+    std::lock_guard<std::mutex> dispatchLock(dispatchMutex);
+    
+    // both vectors keep their reserved capacity across the swap
+    dispatchCompletions.swap(pendingCompletions);
+    pendingCompletions.clear();
+    lock.unlock();
+    
+    if(audioChunkCompletionListener == nullptr)
+    {
+        dispatchCompletions.clear();
+        return;
+    }
+    
+    std::chrono::steady_clock::time_point dispatchStart = std::chrono::steady_clock::now();
+    audioChunkCompletionListener->AudioChunkCompleted(dispatchCompletions);
+    uint64_t dispatchNanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - dispatchStart).count();
+    
+    lockStatistics.dispatches++;
+    lockStatistics.totalDispatchNanoseconds += dispatchNanoseconds;
+    lockStatistics.maxDispatchNanoseconds = std::max(lockStatistics.maxDispatchNanoseconds, dispatchNanoseconds);
+    
+    dispatchCompletions.clear();
+}
+
+void Audiblizer::DrainSubmissions(AudioChunkCompletionListener::AudioChunkCompletedVector &audioChunksCompleted)
+{
+    // NOTE: 'mutex' is held by the caller, which makes whichever thread holds it the ring's (single) consumer
+    
+    AudioSubmission *audioSubmission = nullptr;
+    ALint sourceState = 0;
+    bool  submitted = false;
+    
+    if(playbackMode == PlaybackMode_Queued)
+    {
+        submitted = UploadSubmissions(audioChunksCompleted);
+    }
+    
+    while(playbackMode == PlaybackMode_Callback && (audioSubmission = submissionRing.Front()) != nullptr)
+    {
+        bool success = false;
+        
+        // the callback buffer itself is set up by the first submission, once the format and sample rate are known
+        if(callbackBuffer != 0 || SetUpCallbackBuffer(audioSubmission->audioChunk.format, audioSubmission->audioChunk.sampleRate))
+        {
+            // leave the audio in the submission ring until the mixer has made room for it
+            if(audioSubmission->audioChunk.bufferSize > callbackByteRing.WriteAvailable())
+            {
+                break;
+            }
+            
+            success = WriteCallbackSubmission(*audioSubmission);
+        }
+        
+        // there is no one to hand a failure back to, so the chunk is completed without having been
+        // played (which still returns its memory to the listener and keeps the counts honest)
+        if(!success)
+        {
+            printf("ERROR: Submit Audio Chunk!!!\n");
+            CompleteAudioBufferRecord(AudioBufferRecord(0, audioSubmission->audioChunk.buffer, audioSubmission->audioChunkFrames, audioSubmission->audioChunkDurationMilliseconds, audioSubmission->audioChunkDurationSeconds), audioChunksCompleted);
+        }
+        
+        submissionRing.PopFront();
+        submitted = true;
+    }
+    
+    if(!submitted)
+    {
+        return;
+    }
+    
+    // ensure that the source is playing
+    // --------------------------------------------------------------
+    alGetSourcei(source, AL_SOURCE_STATE, &sourceState);
+    if (alGetError() == AL_NO_ERROR && sourceState != AL_PLAYING && !audioBufferRing.Empty())
+    {
+        alSourcePlay(source);
+        if (alGetError() != AL_NO_ERROR)
+        {
+            printf("ERROR: SourcePlay!!!\n");
+        }
+    }
+}
+
+bool Audiblizer::UploadSubmissions(AudioChunkCompletionListener::AudioChunkCompletedVector &audioChunksCompleted)
+{
+    // NOTE: 'mutex' is held by the caller
+    
+    uint32_t numSubmissions = (uint32_t)std::min(submissionRing.Size(), submissionBuffers.size());
+    
+    if(numSubmissions == 0)
+    {
+        return false;
+    }
+    
+    // everything that is pending goes to OpenAL as one batch. Should the batch fail, fall back to
+    // one chunk at a time, so that a single bad chunk only ever costs itself
+    if(!UploadSubmissionBatch(numSubmissions))
+    {
+        for(uint32_t i = 0; i < numSubmissions; i++)
+        {
+            AudioSubmission *audioSubmission = submissionRing.Peek(i);
+            
+            // there is no one to hand a failure back to, so the chunk is completed without having been
+            // played (which still returns its memory to the listener and keeps the counts honest)
+            if(!UploadSubmission(*audioSubmission))
+            {
+                printf("ERROR: Submit Audio Chunk!!!\n");
+                CompleteAudioBufferRecord(AudioBufferRecord(0, audioSubmission->audioChunk.buffer, audioSubmission->audioChunkFrames, audioSubmission->audioChunkDurationMilliseconds, audioSubmission->audioChunkDurationSeconds), audioChunksCompleted);
+            }
+        }
+    }
+    
+    for(uint32_t i = 0; i < numSubmissions; i++)
+    {
+        submissionRing.PopFront();
+    }
+    
+    return true;
+}
+
+bool Audiblizer::UploadSubmissionBatch(uint32_t numSubmissions)
+{
+    ALCenum error = AL_NO_ERROR;
+    ALuint *buffers = submissionBuffers.data();
+    
+    // grab all of the buffer names at once (any the pool is short are generated by a single alGenBuffers())
+    // --------------------------------------------------------------
+    if(!audioBufferNamePool.Acquire(buffers, numSubmissions))
+    {
+        return false;
+    }
+    
+    // initialize the sound buffers, checking for errors once for the lot
+    // NOTE: this check can't be folded into the one after queueing, as there would then be no telling
+    //       whether a buffer w/o data had made it onto the source
+    // --------------------------------------------------------------
+    for(uint32_t i = 0; i < numSubmissions; i++)
+    {
+        const AudioChunk &audioChunk = submissionRing.Peek(i)->audioChunk;
+        alBufferData(buffers[i], OpenALAudioFormat(audioChunk.format), audioChunk.buffer, (ALsizei)audioChunk.bufferSize, (ALsizei)audioChunk.sampleRate);
+    }
+    
+    error = alGetError();
+    if (error != AL_NO_ERROR)
+    {
+        audioBufferNamePool.Release(buffers, numSubmissions);
+        return false;
+    }
+    
+    // Queue all of the sound buffers onto source (which either queues all of them or none of them)
+    // --------------------------------------------------------------
+    alSourceQueueBuffers(source, (ALsizei)numSubmissions, buffers);
+    error = alGetError();
+    if (error != AL_NO_ERROR)
+    {
+        audioBufferNamePool.Release(buffers, numSubmissions);
+        return false;
+    }
+    
+    // append buffers to the end of audioBufferRing (which is always in queue order)
+    // --------------------------------------------------------------
+    for(uint32_t i = 0; i < numSubmissions; i++)
+    {
+        const AudioSubmission &audioSubmission = *submissionRing.Peek(i);
+        audioBufferRing.Push(AudioBufferRecord(buffers[i], audioSubmission.audioChunk.buffer, audioSubmission.audioChunkFrames, audioSubmission.audioChunkDurationMilliseconds, audioSubmission.audioChunkDurationSeconds));
+    }
+    
+    if(positionSampleRate == 0)
+    {
+        positionMutex.lock();
+        positionSampleRate = submissionRing.Peek(0)->audioChunk.sampleRate;
+        positionMutex.unlock();
+    }
+    
+    return true;
+}
+
+bool Audiblizer::UploadSubmission(const AudioSubmission &audioSubmission)
+{
+    ALCenum error = AL_NO_ERROR;
+    ALuint buffer = 0;
+    
+    // grab a buffer name from the pool and initialize the sound buffer
+    // --------------------------------------------------------------
+    if(!audioBufferNamePool.Acquire(&buffer, 1))
+    {
+        return false;
+    }
+    
+    alBufferData(buffer, OpenALAudioFormat(audioSubmission.audioChunk.format), audioSubmission.audioChunk.buffer, (ALsizei)audioSubmission.audioChunk.bufferSize, (ALsizei)audioSubmission.audioChunk.sampleRate);
+    error = alGetError();
+    if (error != AL_NO_ERROR)
+    {
+        audioBufferNamePool.Release(&buffer, 1);
+        return false;
+    }
+    
+    // Queue sound buffer onto source
+    // --------------------------------------------------------------
+    alSourceQueueBuffers(source, 1, &buffer);
+    error = alGetError();
+    if (error != AL_NO_ERROR)
+    {
+        audioBufferNamePool.Release(&buffer, 1);
+        return false;
+    }
+    
+    // append buffer to the end of audioBufferRing (which is always in queue order)
+    // --------------------------------------------------------------
+    audioBufferRing.Push(AudioBufferRecord(buffer, audioSubmission.audioChunk.buffer, audioSubmission.audioChunkFrames, audioSubmission.audioChunkDurationMilliseconds, audioSubmission.audioChunkDurationSeconds));
+    
+    if(positionSampleRate == 0)
+    {
+        positionMutex.lock();
+        positionSampleRate = audioSubmission.audioChunk.sampleRate;
+        positionMutex.unlock();
+    }
+    
+    return true;
+}
+
+Audiblizer::AudioTimestamp Audiblizer::PlaybackPosition()
+{
+    // NOTE: 'alMutex' rather than 'mutex' (see positionMutex), which still keeps the alGetError()s below from
+    //       racing those of the timer thread
+    std::lock_guard<std::mutex> alLock(alMutex);
+    std::lock_guard<std::mutex> lock(positionMutex);
+    
+    AudioTimestamp audioTimestamp;
+    int64_t  position = 0; // in sample frames, as mixed
+    int64_t  latencyNanoseconds = 0;
+    ALint    sampleOffset = 0;
+    ALint64SOFT sampleOffsetLatency[2] = { 0, 0 }; // 32.32 fixed-point sample offset, latency in nanoseconds
+    
+    if(!initialized || positionSampleRate == 0)
+    {
+        return audioTimestamp;
+    }
+    
+    // query the offset and the latency together, so that they describe the same instant
+    if(alGetSourcei64vSOFT != nullptr)
+    {
+        alGetSourcei64vSOFT(source, AL_SAMPLE_OFFSET_LATENCY_SOFT, sampleOffsetLatency);
+        if(alGetError() == AL_NO_ERROR)
+        {
+            sampleOffset = (ALint)(sampleOffsetLatency[0] >> 32);
+            latencyNanoseconds = sampleOffsetLatency[1];
+            audioTimestamp.latencyCompensated = true;
+        }
+    }
+    
+    if(!audioTimestamp.latencyCompensated)
+    {
+        alGetSourcei(source, AL_SAMPLE_OFFSET, &sampleOffset);
+        if(alGetError() != AL_NO_ERROR)
+        {
+            sampleOffset = 0;
+        }
+    }
+    
+    if(playbackMode == PlaybackMode_Callback)
+    {
+        // the callback buffer has no meaningful offset, but we know exactly how much audio the mixer has pulled
+        position = callbackByteRing.BytesRead() / AudioFormatFrameByteLength(callbackFormat);
+    }
+    else
+    {
+        // AL_SAMPLE_OFFSET is relative to the first buffer that is still queued on the source
+        position = positionFramesCompleted + sampleOffset;
+    }
+    
+    // take out what has been mixed, but not yet heard
+    position -= (latencyNanoseconds * positionSampleRate) / 1000000000LL;
+    if(position < 0)
+    {
+        position = 0;
+    }
+    
+    // the source reports an offset of 0 once it has run dry (until its buffers are unqueued), so hold still
+    // rather than step back
+    if((uint64_t)position < positionLastSamples)
+    {
+        position = positionLastSamples;
+    }
+    
+    positionLastSamples = position;
+    
+    audioTimestamp.samples = position;
+    audioTimestamp.nanoseconds = (audioTimestamp.samples * 1000000000ULL) / positionSampleRate;
+    audioTimestamp.sampleRate = positionSampleRate;
+    audioTimestamp.latencyNanoseconds = latencyNanoseconds > 0 ? latencyNanoseconds : 0;
+    
+    return audioTimestamp;
+}
+
+bool Audiblizer::OpenLoopbackDevice(uint32_t sampleRate)
+{
+    LPALCLOOPBACKOPENDEVICESOFT      alcLoopbackOpenDeviceSOFT = nullptr;
+    LPALCISRENDERFORMATSUPPORTEDSOFT alcIsRenderFormatSupportedSOFT = nullptr;
+    
+    if(!alcIsExtensionPresent(NULL, "ALC_SOFT_loopback"))
+    {
+        return false;
+    }
+    
+    alcLoopbackOpenDeviceSOFT = (LPALCLOOPBACKOPENDEVICESOFT) alcGetProcAddress(NULL, "alcLoopbackOpenDeviceSOFT");
+    alcIsRenderFormatSupportedSOFT = (LPALCISRENDERFORMATSUPPORTEDSOFT) alcGetProcAddress(NULL, "alcIsRenderFormatSupportedSOFT");
+    alcRenderSamplesSOFT = (LPALCRENDERSAMPLESSOFT) alcGetProcAddress(NULL, "alcRenderSamplesSOFT");
+    if(alcLoopbackOpenDeviceSOFT == nullptr || alcIsRenderFormatSupportedSOFT == nullptr || alcRenderSamplesSOFT == nullptr)
+    {
+        alcRenderSamplesSOFT = nullptr;
+        return false;
+    }
+    
+    device = alcLoopbackOpenDeviceSOFT(NULL);
+    if(device == nullptr)
+    {
+        return false;
+    }
+    
+    if(!alcIsRenderFormatSupportedSOFT(device, (ALCsizei)sampleRate, ALC_STEREO_SOFT, ALC_SHORT_SOFT))
+    {
+        alcCloseDevice(device);
+        device = nullptr;
+        return false;
+    }
+    
+    // the render format of a loopback device is given by the attributes of its context
+    const ALCint contextAttributes[] =
+    {
+        ALC_FORMAT_CHANNELS_SOFT, ALC_STEREO_SOFT,
+        ALC_FORMAT_TYPE_SOFT,     ALC_SHORT_SOFT,
+        ALC_FREQUENCY,            (ALCint)sampleRate,
+        0
+    };
+    
+    context = alcCreateContext(device, contextAttributes);
+    if(context == nullptr)
+    {
+        alcCloseDevice(device);
+        device = nullptr;
+        return false;
+    }
+    
+    loopbackDevice = true;
+    loopbackSampleRate = sampleRate;
+    
+    return true;
+}
+
+bool Audiblizer::RenderLoopback(int16_t *buffer, uint32_t numFrames)
+{
+    if(!initialized || !loopbackDevice || buffer == nullptr)
+    {
+        return false;
+    }
+    
+    // NOTE: we do NOT take 'mutex' here, as rendering may synchronously call back into
+    //       the Audiblizer (see BufferCallback()), and because OpenAL serializes rendering
+    //       against any changes that QueueAudio() et al. make to the source
+    alcRenderSamplesSOFT(device, buffer, (ALCsizei)numFrames);
+    
+    return alcGetError(device) == ALC_NO_ERROR;
+}
+
+void Audiblizer::CompleteAudioBufferRecord(const AudioBufferRecord &audioBufferRecord, AudioChunkCompletionListener::AudioChunkCompletedVector &audioChunksCompleted)
+{
+    // if there is a listener, the listener is responsible for freeing this memory,
+    // so insert the dataPtr into the buffersCompleted vector
+    if(audioChunkCompletionListener != nullptr)
+    {
+        audioChunksCompleted.push_back(AudioChunkCompletionListener::AudioChunkProperties(audioBufferRecord.audioBufferData, audioBufferRecord.audioBufferDurationSeconds));
+    }
+    // otherwise WE free() this memory
+    else
+    {
+        if(audioBufferRecord.audioBufferData != nullptr)
+        {
+            free(audioBufferRecord.audioBufferData);
+        }
+    }
+    
+    // lop off the completed buffer from the totals
+    queuedChunkCount -= 1;
+    queuedDurationMilliseconds -= audioBufferRecord.audioBufferDurationMilliseconds;
+}
+
+size_t Audiblizer::CallbackByteRingCapacity(AudioFormat format, uint32_t sampleRate)
+{
+    return (size_t)(callbackBufferDurationSeconds * sampleRate) * AudioFormatFrameByteLength(format);
+}
+
+bool Audiblizer::SetUpCallbackBuffer(AudioFormat format, uint32_t sampleRate)
+{
+    size_t ringCapacity = CallbackByteRingCapacity(format, sampleRate);
+    
+    if(ringCapacity == 0)
+    {
+        return false;
+    }
+    
+    if(!callbackByteRing.Allocate(ringCapacity))
+    {
+        return false;
+    }
+    
+    alGenBuffers(1, &callbackBuffer);
+    if(alGetError() != AL_NO_ERROR)
+    {
+        callbackBuffer = 0;
+        callbackByteRing.Release();
+        return false;
+    }
+    
+    alBufferCallbackSOFT(callbackBuffer, OpenALAudioFormat(format), (ALsizei)sampleRate, BufferCallback, this);
+    alSourcei(source, AL_BUFFER, (ALint)callbackBuffer);
+    if(alGetError() != AL_NO_ERROR)
+    {
+        alDeleteBuffers(1, &callbackBuffer);
+        callbackBuffer = 0;
+        callbackByteRing.Release();
+        return false;
+    }
+    
+    callbackFormat = format;
+    callbackSampleRate = sampleRate;
+    callbackSilence = (format == AudioFormat_Mono8 || format == AudioFormat_Stereo8) ? 0x80 : 0x00;
+    
+    positionMutex.lock();
+    positionSampleRate = sampleRate;
+    positionMutex.unlock();
+    
+    return true;
+}
+
+bool Audiblizer::WriteCallbackSubmission(const AudioSubmission &audioSubmission)
+{
+    // NOTE: 'mutex' is held by the caller, which has already made sure that there is room in the ring
+    
+    // copy the audio into the ring that the mixer pulls from
+    if(!callbackByteRing.Write(audioSubmission.audioChunk.buffer, audioSubmission.audioChunk.bufferSize))
+    {
+        return false;
+    }
+    
+    AudioBufferRecord audioBufferRecord(0, audioSubmission.audioChunk.buffer, audioSubmission.audioChunkFrames, audioSubmission.audioChunkDurationMilliseconds, audioSubmission.audioChunkDurationSeconds);
+    audioBufferRecord.endByteOffset = callbackByteRing.BytesWritten();
+    
+    audioBufferRing.Push(audioBufferRecord);
+    
+    return true;
+}
+
+ALsizei Audiblizer::BufferCallback(ALvoid *userptr, ALvoid *sampledata, ALsizei numbytes)
+{
+    Audiblizer *audiblizer = (Audiblizer*) userptr;
+    
+    // NOTE: called on OpenAL's mixer thread, so we must never lock, block or allocate in here
+    size_t bytesRead = audiblizer->callbackByteRing.Read(sampledata, (size_t)numbytes);
+    
+    // on underrun, render silence rather than returning short (which would end the stream and stop
+    // the source). The silence is never counted as consumed, so completions stay sample-exact
+    if(bytesRead < (size_t)numbytes)
+    {
+        memset((uint8_t*)sampledata + bytesRead, audiblizer->callbackSilence, (size_t)numbytes - bytesRead);
+    }
+    
+    return numbytes;
+}
+
+bool Audiblizer::ProcessConsumedCallbackAudio()
+{
+    // the mixer reports exactly how many bytes (and thus samples) it has pulled out of the ring, so
+    // there is nothing to do (and no reason to lock) until that count moves or new audio is submitted
+    if(callbackByteRing.BytesRead() == callbackBytesCompleted && submissionRing.Empty())
+    {
+        return true;
+    }
+    
+    std::unique_lock<std::mutex> lock(mutex);
+    std::chrono::steady_clock::time_point lockAcquired = std::chrono::steady_clock::now();
+    
+    if(!initialized)
+    {
+        return false;
+    }
+    
+    uint64_t bytesConsumed = callbackByteRing.BytesRead();
+    
+    // nothing from here until the listener is called should touch the heap
+    AllocationTracker::Begin();
+    
+    // move any newly submitted audio into the ring that the mixer pulls from (which may set up the callback buffer)
+    alMutex.lock();
+    DrainSubmissions(pendingCompletions);
+    alMutex.unlock();
+    
+    // every chunk whose last sample has been pulled by the mixer is complete
+    while(!audioBufferRing.Empty() && audioBufferRing.Front().endByteOffset <= bytesConsumed)
+    {
+        CompleteAudioBufferRecord(audioBufferRing.Front(), pendingCompletions);
+        audioBufferRing.PopFront();
+    }
+    
+    callbackBytesCompleted = bytesConsumed;
+    
+    // call the audioChunkCompletion listener (after releasing 'mutex')
+    DispatchCompletions(lock, lockAcquired);
+    
+    return true;
+}
+
+bool Audiblizer::AudioBufferNamePool::Reserve(uint32_t count)
+{
+    if(count <= numNames)
+    {
+        return true;
+    }
+    
+    uint32_t numNewNames = count - numNames;
+    size_t   firstNewName = freeNames.size();
+    
+    // keep room for every name that the pool owns, growing geometrically so that repeated misses stay cheap
+    if(freeNames.capacity() < count)
+    {
+        freeNames.reserve(std::max<size_t>(count, freeNames.capacity() * 2));
+    }
+    
+    freeNames.resize(firstNewName + numNewNames);
+    
+    alGenBuffers((ALsizei)numNewNames, &freeNames[firstNewName]);
+    if(alGetError() != AL_NO_ERROR)
+    {
+        freeNames.resize(firstNewName);
+        return false;
+    }
+    
+    numNames += numNewNames;
+    
+    return true;
+}
+
+bool Audiblizer::AudioBufferNamePool::Acquire(ALuint *names, uint32_t count)
+{
+    if(names == nullptr)
+    {
+        return false;
+    }
+    
+    if(freeNames.size() < count)
+    {
+        // the pool ran dry, so grow it by just the names that it is short
+        uint32_t numMissing = count - (uint32_t)freeNames.size();
+        
+        if(!Reserve(numNames + numMissing))
+        {
+            return false;
+        }
+        
+        misses += numMissing;
+        hits += count - numMissing;
+    }
+    else
+    {
+        hits += count;
+    }
+    
+    for(uint32_t i = 0; i < count; i++)
+    {
+        names[i] = freeNames.back();
+        freeNames.pop_back();
+    }
+    
+    uint32_t numInFlight = numNames - (uint32_t)freeNames.size();
+    if(numInFlight > highWaterMark)
+    {
+        highWaterMark = numInFlight;
+    }
+    
+    return true;
+}
+
+void Audiblizer::AudioBufferNamePool::Release(const ALuint *names, uint32_t count)
+{
+    // freeNames always has capacity for every name that the pool owns, so this never reallocates
+    for(uint32_t i = 0; i < count; i++)
+    {
+        freeNames.push_back(names[i]);
+    }
+}
+
+void Audiblizer::AudioBufferNamePool::Destroy()
+{
+    // NOTE: all names must have been released (i.e. unbound from the source) prior to this call
+    if(!freeNames.empty())
+    {
+        alDeleteBuffers((ALsizei)freeNames.size(), freeNames.data());
+    }
+    
+    freeNames.clear();
+    numNames = 0;
+}
+
+Audiblizer::BufferPoolStatistics Audiblizer::AudioBufferNamePool::Statistics() const
+{
+    BufferPoolStatistics statistics;
+    
+    statistics.hits = hits;
+    statistics.misses = misses;
+    statistics.highWaterMark = highWaterMark;
+    statistics.poolSize = numNames;
+    
+    return statistics;
+}
+
 ALenum Audiblizer::OpenALAudioFormat(AudioFormat audioFormat)
 {
     ALenum openALEnum = (ALenum)0;
@@ -26,22 +26,32 @@
 
 #include <iostream>
 #include <mutex>
-#include <map>
 #include <vector>
 #include <iterator>
 #include <thread>
 #include <memory>
+#include <atomic>
+#include <algorithm>
+#include <chrono>
 #include <OpenAL/al.h>
 #include <OpenAL/alc.h>
 
+#include "OpenALExtensions.h"
 #include "HighPrecisionTimer.h"
 #include "Event.h"
+#include "RingBuffer.h"
+#include "AllocationTracker.h"
 
 class Audiblizer : public HighPrecisionTimer::Delegate
 {
 public:
     enum AudioFormat { AudioFormat_None = 0, AudioFormat_Mono8, AudioFormat_Mono16, AudioFormat_Stereo8, AudioFormat_Stereo16 };
     
+    // PlaybackMode_Queued   -- every audio chunk is uploaded into its own OpenAL buffer and queued onto the source
+    // PlaybackMode_Callback -- audio chunks are copied into a lock-free ring, which the OpenAL mixer pulls from
+    //                          via AL_SOFT_callback_buffer (falls back to PlaybackMode_Queued when unavailable)
+    enum PlaybackMode { PlaybackMode_Queued = 0, PlaybackMode_Callback };
+    
     class AudioChunkCompletionListener
     {
     public:
@@ -72,26 +82,102 @@ public:
         size_t      bufferSize;
     };
     
+    class Configuration
+    {
+    public:
+        Configuration() : maxQueuedChunks(512), useEvents(true), playbackMode(PlaybackMode_Queued), callbackBufferDurationSeconds(5.0), loopback(false), loopbackSampleRate(48000) {}
+        
+        uint32_t     maxQueuedChunks;               // max number of audio chunks queued at once (sizes the buffer name pool and the chunk ring)
+        bool         useEvents;                     // reclaim buffers from AL_SOFT_events buffer-completed callbacks when the extension is available
+        PlaybackMode playbackMode;
+        double       callbackBufferDurationSeconds; // PlaybackMode_Callback only: how much audio the lock-free ring can hold
+        bool         loopback;                      // open a headless ALC_SOFT_loopback device, which only plays as RenderLoopback() is called
+        uint32_t     loopbackSampleRate;            // loopback only: the rate at which RenderLoopback() renders (always 16-bit stereo)
+    };
+    
+    class BufferPoolStatistics
+    {
+    public:
+        BufferPoolStatistics() : hits(0), misses(0), highWaterMark(0), poolSize(0) {}
+        
+        uint64_t hits;          // buffer names handed out from the pool
+        uint64_t misses;        // buffer names that had to be generated via alGenBuffers() after Initialize()
+        uint32_t highWaterMark; // max number of buffer names in flight at any one time
+        uint32_t poolSize;      // total number of buffer names owned by the pool
+    };
+    
+    class AudioTimestamp
+    {
+    public:
+        AudioTimestamp() : samples(0), nanoseconds(0), sampleRate(0), latencyNanoseconds(0), latencyCompensated(false) {}
+        
+        uint64_t samples;            // sample frames heard since playback began (or since the last Stop())
+        uint64_t nanoseconds;        // 'samples' expressed in nanoseconds
+        uint32_t sampleRate;         // the rate of the queued audio (0 if nothing has been queued yet)
+        uint64_t latencyNanoseconds; // the device latency that was taken out of 'samples'
+        bool     latencyCompensated; // true if the device latency was known (via AL_SOFT_source_latency)
+    };
+    
+    class LockStatistics
+    {
+    public:
+        LockStatistics() : acquisitions(0), totalHoldNanoseconds(0), maxHoldNanoseconds(0), dispatches(0), totalDispatchNanoseconds(0), maxDispatchNanoseconds(0) {}
+        
+        uint64_t acquisitions;             // times that the timer / event path took 'mutex'
+        uint64_t totalHoldNanoseconds;     // total time that the timer / event path held 'mutex'
+        uint64_t maxHoldNanoseconds;
+        uint64_t dispatches;               // AudioChunkCompleted() calls, all of which are made after 'mutex' is released
+        uint64_t totalDispatchNanoseconds; // total time spent in AudioChunkCompleted() (which used to be spent holding 'mutex')
+        uint64_t maxDispatchNanoseconds;
+    };
+    
     Audiblizer();
     ~Audiblizer();
     
-    bool Initialize();
+    bool Initialize(const Configuration &configuration = Configuration());
     void PrepareForDestruction();
     
+    // NOTE: AudioChunkCompleted() is called ***without*** 'mutex' held, so the listener is free to QueueAudio(),
+    //       query the position, etc. It must NOT call Stop() though, as completions are serialized with one another
     void SetBuffersCompletedListener(std::shared_ptr<AudioChunkCompletionListener> listener);
     
+    // NOTE: QueueAudio(), NumBuffersQueued() and QueuedAudioDurationSeconds() never lock. Queued audio
+    //       is handed off to the timer thread via a single-producer ring, so only ONE thread may QueueAudio()
     typedef std::vector<AudioChunk> AudioChunkVector;
     bool QueueAudio(const AudioChunkVector &audioChunks);
     uint32_t NumBuffersQueued();
     double   QueuedAudioDurationSeconds();
     
+    BufferPoolStatistics GetBufferPoolStatistics();
+    LockStatistics       GetLockStatistics();
+    
+    // sample-accurate position of the audio that is actually coming out of the device, which
+    // (unlike the completion of chunks) does not jitter w/ the buffer dequeue granularity.
+    // NOTE: monotonic, so it holds still rather than stepping back (e.g. across an underrun)
+    AudioTimestamp PlaybackPosition();
+    
+    // true if buffers are reclaimed via AL_SOFT_events callbacks rather than by polling
+    bool EventDriven() { return eventDriven; }
+    
+    // the mode that is actually in use, which may differ from the one requested at Initialize()
+    PlaybackMode GetPlaybackMode() { return playbackMode; }
+    
+    // Loopback (headless) device
+    // NOTE: on a loopback device nothing plays, and no buffers complete, but for the samples that
+    //       are rendered via RenderLoopback(), which allows playback to be driven by a virtual clock
+    // ------------------------------------------------------------------
+    bool     Loopback() { return loopbackDevice; }
+    uint32_t LoopbackSampleRate() { return loopbackSampleRate; }
+    bool     RenderLoopback(int16_t *buffer, uint32_t numFrames); // 'buffer' receives 'numFrames' interleaved 16-bit stereo frames
+    
     bool Stop();
     
     // HighPrecisionTimer::Delegate Interface
     // ------------------------------------------------------------------
     virtual void TimerPing();
-    virtual double TimerPeriod() { return 0.0001; }
+    virtual double TimerPeriod() { return eventDriven && submissionRing.Empty() ? 0.1 : 0.00025; } // when event driven, polling is merely a safety sweep (and a way to pick up submitted audio)
     virtual bool FireOnce() { return false; }
+    virtual const char* TimerDelegateName() { return "audio"; }
     
     // Static Functions
     // ------------------------------------------------------------------
@@ -110,30 +196,147 @@ private:
     
     std::shared_ptr<AudioChunkCompletionListener> audioChunkCompletionListener;
     
-    class AudioBufferMapValue
+    // OpenAL always unqueues buffers in the order that they were queued, so the queued buffers are
+    // tracked in a FIFO ring (in queue order) rather than in a map keyed by buffer name
+    class AudioBufferRecord
     {
     public:
-        AudioBufferMapValue() { audioBufferData = nullptr; audioBufferDurationMilliseconds = 0; }
-        AudioBufferMapValue(void *data, uint64_t durationMS, double duration) { audioBufferData = data; audioBufferDurationMilliseconds = durationMS; audioBufferDurationSeconds = duration; }
+        AudioBufferRecord() { buffer = 0; endByteOffset = 0; audioBufferData = nullptr; audioBufferFrames = 0; audioBufferDurationMilliseconds = 0; audioBufferDurationSeconds = 0; }
+        AudioBufferRecord(ALuint name, void *data, uint64_t frames, uint64_t durationMS, double duration) { buffer = name; endByteOffset = 0; audioBufferData = data; audioBufferFrames = frames; audioBufferDurationMilliseconds = durationMS; audioBufferDurationSeconds = duration; }
         
-        void *audioBufferData;
+        ALuint   buffer; // Buffer ID (PlaybackMode_Queued)
+        uint64_t endByteOffset; // offset into the callback byte stream at which this chunk ends (PlaybackMode_Callback)
+        void    *audioBufferData;
+        uint64_t audioBufferFrames; // number of sample frames in this audio buffer
         uint64_t audioBufferDurationMilliseconds; // duration of this audio buffer in TRUNCATED milliseconds
         double   audioBufferDurationSeconds; // duration of this audio buffer in real secodns
     };
     
-    typedef ALuint AudioBufferMapKey; // Buffer ID
-    typedef std::map<AudioBufferMapKey, AudioBufferMapValue> AudioBufferMap;
-    typedef std::pair<AudioBufferMapKey, AudioBufferMapValue> AudioBufferMapPair;
-    typedef AudioBufferMap::iterator AudioBufferMapIterator;
-    typedef std::pair<AudioBufferMapIterator, bool> AudioBufferMapInsertionPair;
+    typedef RingBuffer<AudioBufferRecord> AudioBufferRing;
+    
+    AudioBufferRing audioBufferRing;
+    
+    // --- Submission ring
+    // QueueAudio() only validates the audio chunks and pushes them onto 'submissionRing', which the timer
+    // thread drains into OpenAL. Neither side ever waits on the other. The queued count and duration
+    // cover both the submitted audio and the audio already in OpenAL, and are published via atomics
+    class AudioSubmission
+    {
+    public:
+        AudioSubmission() : audioChunkFrames(0), audioChunkDurationMilliseconds(0), audioChunkDurationSeconds(0) {}
+        
+        AudioChunk audioChunk;
+        uint64_t   audioChunkFrames;
+        uint64_t   audioChunkDurationMilliseconds;
+        double     audioChunkDurationSeconds;
+    };
+    
+    LockFreeRingBuffer<AudioSubmission> submissionRing;
+    std::atomic<uint32_t> queuedChunkCount;
+    std::atomic<uint64_t> queuedDurationMilliseconds; // in TRUNCATED milliseconds
+    uint32_t              maxQueuedChunks;
+    AudioFormat           submissionFormat;     // producer side only: the format of the first audio ever submitted (PlaybackMode_Callback)
+    uint32_t              submissionSampleRate; // producer side only: the rate of the first audio ever submitted (PlaybackMode_Callback)
+    
+    std::vector<ALuint>   submissionBuffers;    // consumer side only: scratch names for a batch of uploads (PlaybackMode_Queued)
+    
+    void DrainSubmissions(AudioChunkCompletionListener::AudioChunkCompletedVector &audioChunksCompleted);
+    bool UploadSubmissions(AudioChunkCompletionListener::AudioChunkCompletedVector &audioChunksCompleted);
+    bool UploadSubmissionBatch(uint32_t numSubmissions);
+    bool UploadSubmission(const AudioSubmission &audioSubmission);
+    bool WriteCallbackSubmission(const AudioSubmission &audioSubmission);
+    
+    // --- Buffer name pool
+    // OpenAL buffer names are recycled rather than generated and deleted per chunk, such that
+    // steady-state playback does not allocate anything within the driver
+    class AudioBufferNamePool
+    {
+    public:
+        AudioBufferNamePool() : numNames(0), hits(0), misses(0), highWaterMark(0) {}
+        
+        bool Reserve(uint32_t count);
+        bool Acquire(ALuint *names, uint32_t count);
+        void Release(const ALuint *names, uint32_t count);
+        void Destroy();
+        
+        BufferPoolStatistics Statistics() const;
+        
+    private:
+        std::vector<ALuint> freeNames;
+        uint32_t numNames; // free names plus names that are currently in flight
+        uint64_t hits;
+        uint64_t misses;
+        uint32_t highWaterMark;
+    };
+    
+    AudioBufferNamePool audioBufferNamePool;
+    
+    std::atomic<bool> initialized;
+    
+    // --- AL_SOFT_events
+    bool                  eventDriven;
+    LPALEVENTCONTROLSOFT  alEventControlSOFT;
+    LPALEVENTCALLBACKSOFT alEventCallbackSOFT;
+    
+    bool EnableEvents();
+    void DisableEvents();
+    static void EventCallback(ALenum eventType, ALuint object, ALuint param, ALsizei length, const ALchar *message, void *userParam);
+    
+    // --- AL_SOFT_callback_buffer
+    PlaybackMode           playbackMode;
+    LPALBUFFERCALLBACKSOFT alBufferCallbackSOFT;
+    ALuint                 callbackBuffer;
+    AudioFormat            callbackFormat;
+    uint32_t               callbackSampleRate;
+    uint8_t                callbackSilence;
+    double                 callbackBufferDurationSeconds;
+    LockFreeByteRing       callbackByteRing; // written by QueueAudio(), read by the OpenAL mixer
+    std::atomic<uint64_t>  callbackBytesCompleted; // bytes of the callback stream that have been reported as completed
+    
+    size_t CallbackByteRingCapacity(AudioFormat format, uint32_t sampleRate); // in bytes
+    bool SetUpCallbackBuffer(AudioFormat format, uint32_t sampleRate);
+    static ALsizei BufferCallback(ALvoid *userptr, ALvoid *sampledata, ALsizei numbytes);
+    
+    // --- ALC_SOFT_loopback
+    bool                   loopbackDevice;
+    uint32_t               loopbackSampleRate;
+    LPALCRENDERSAMPLESSOFT alcRenderSamplesSOFT;
+    
+    bool OpenLoopbackDevice(uint32_t sampleRate);
+    
+    // --- Playback position
+    // NOTE: has its own mutex (rather than using 'mutex') as PlaybackPosition() is called from within the
+    //       AudioChunkCompletionListener / timer callbacks of clients, which may hold locks of their own
+    //       that they take while being called back from within 'mutex'
+    std::mutex            positionMutex;
+    
+    // OpenAL keeps a single error state per context, so an AL call and the alGetError() that checks it must not be
+    // interleaved w/ those of another thread. Held (inside of 'mutex', and outside of 'positionMutex') for as long
+    // as AL calls are made, but never while calling out to anyone, which lets PlaybackPosition() take it as well
+    std::mutex            alMutex;
+    uint64_t              positionFramesCompleted; // frames in all of the buffers unqueued since the last Stop()
+    uint64_t              positionLastSamples; // last position handed out, which keeps the position monotonic
+    uint32_t              positionSampleRate;
+    LPALGETSOURCEI64VSOFT alGetSourcei64vSOFT;
     
-    AudioBufferMap audioBufferMap;
-    uint64_t audioBufferMapDurationMilliseconds; // duration of all the audio contained in the audioBufferMap, as measured in milliseconds
+    // --- Completion dispatch
+    // completions are collected while holding 'mutex', then delivered after it is released. 'dispatchMutex' is
+    // taken before 'mutex' is let go of, such that completions are still delivered one at a time and in order
+    // Both completion vectors are reserved by Initialize() to hold every chunk that can be queued at once,
+    // so that reclaiming audio never touches the heap. 'pendingCompletions' is filled while holding 'mutex',
+    // then swapped w/ 'dispatchCompletions' (which is only touched while holding 'dispatchMutex')
+    std::mutex     dispatchMutex;
+    LockStatistics lockStatistics; // hold times are guarded by 'mutex', dispatch times by 'dispatchMutex'
+    AudioChunkCompletionListener::AudioChunkCompletedVector pendingCompletions;
+    AudioChunkCompletionListener::AudioChunkCompletedVector dispatchCompletions;
     
-    bool initialized;
+    void RecordLockHold(const std::chrono::steady_clock::time_point &lockAcquired);
+    void DispatchCompletions(std::unique_lock<std::mutex> &lock, const std::chrono::steady_clock::time_point &lockAcquired);
     
     // --- Process unqueueable buffers
     bool ProcessUnqueueableBuffers();
+    bool ProcessConsumedCallbackAudio();
+    void CompleteAudioBufferRecord(const AudioBufferRecord &audioBufferRecord, AudioChunkCompletionListener::AudioChunkCompletedVector &audioChunksCompleted);
 };
 
 #endif /* Audiblizer_h */
@@ -24,6 +24,9 @@
 
 #include "AudiblizerTestHarness.h"
 #include <cmath>
+#include <cerrno>
+#include <cstring>
+#include <algorithm>
 
 const Audiblizer::AudioFormat AudiblizerTestHarness::audioFormat = Audiblizer::AudioFormat_Stereo16;
 
@@ -50,6 +53,7 @@ AudiblizerTestHarness::AudiblizerTestHarness() :
     audioQueueingThread(nullptr),
     audioQueueingThreadRunning(false),
     audioQueueingThreadTerminated(false, false),
+    audioQueueingThreadWake(false, false),
     audioSampleRate(0),
     audioIsStereo(true),
     audioIsSilence(true),
@@ -59,9 +63,23 @@ AudiblizerTestHarness::AudiblizerTestHarness() :
     adversarialTestingAudioChunkCacheSize(1),
     adversarialTestingAudioChunkCacheAccum(0),
     maxQueuedAudioDurationSeconds(4.0),
+    queuedAudioLowWatermarkSeconds(3.75),
+    steadyStateAllocationBaseline(0),
+    steadyStateAllocationBaselineTaken(false),
+    outputDataDropped(0),
+    traceFile(nullptr),
+    traceRecordsWritten(0),
+    traceWriteFailed(false),
     dataOutputThread(nullptr),
     dataOutputThreadRunning(false),
     dataOutputter(nullptr),
+    clock(nullptr),
+    virtualClock(nullptr),
+    audioChunkScheduleIter(0),
+    loopbackCapture(false),
+    loopbackFramesRendered(0),
+    loopbackChecksum(0),
+    loopbackWallClockSeconds(0),
     initialized(false)
 {
     
@@ -75,7 +93,7 @@ AudiblizerTestHarness::~AudiblizerTestHarness()
     audioData = nullptr;
 }
 
-bool AudiblizerTestHarness::Initialize()
+bool AudiblizerTestHarness::Initialize(const Audiblizer::Configuration &audiblizerConfiguration)
 {
     std::lock_guard<std::mutex> lock(mutex);
     
@@ -89,7 +107,7 @@ bool AudiblizerTestHarness::Initialize()
     // Audiblizer
     // --------------------------------------------
     audiblizer = std::make_shared<Audiblizer>();
-    if(audiblizer == nullptr || !audiblizer->Initialize())
+    if(audiblizer == nullptr || !audiblizer->Initialize(audiblizerConfiguration))
     {
         audiblizer = nullptr;
         retVal = false;
@@ -99,6 +117,22 @@ bool AudiblizerTestHarness::Initialize()
     
     audiblizer->SetBuffersCompletedListener(getptr());
     
+    // Clock
+    // --------------------------------------------
+    if(clock == nullptr)
+    {
+        clock = audiblizer->Loopback() ? std::make_shared<VirtualClock>() : Clock::Steady();
+    }
+    
+    virtualClock = std::dynamic_pointer_cast<VirtualClock>(clock);
+    if(clock->Virtual() != audiblizer->Loopback() || (clock->Virtual() && virtualClock == nullptr))
+    {
+        printf("ERROR: A loopback device must be driven by a VirtualClock, and any other device by a real clock!!!\n");
+        retVal = false;
+        
+        goto Exit;
+    }
+    
     // VideoTimerDelegate
     // --------------------------------------------
     videoTimerDelegate = std::make_shared<VideoTimerDelegate>();
@@ -113,7 +147,7 @@ bool AudiblizerTestHarness::Initialize()
     
     // HighPrecisionTimer
     // --------------------------------------------
-    highPrecisionTimer = std::make_shared<HighPrecisionTimer>();
+    highPrecisionTimer = std::make_shared<HighPrecisionTimer>(clock);
     
     // add videoTimerDelegate and audiblizer as delegates to timer
     highPrecisionTimer->AddDelegate(videoTimerDelegate);
@@ -236,6 +270,73 @@ void AudiblizerTestHarness::PrepareForDestruction()
     initialized = false;
 }
 
+bool AudiblizerTestHarness::SetClock(std::shared_ptr<Clock> testClock)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    
+    if(initialized)
+    {
+        return false;
+    }
+    
+    clock = testClock;
+    
+    return true;
+}
+
+bool AudiblizerTestHarness::SetTimerThreadPolicy(const HighPrecisionTimer::ThreadPolicy &policy)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    
+    if(!initialized)
+    {
+        return false;
+    }
+    
+    return highPrecisionTimer->SetThreadPolicy(policy);
+}
+
+bool AudiblizerTestHarness::SetTimerDispatchMode(HighPrecisionTimer::DispatchMode mode)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    
+    if(!initialized)
+    {
+        return false;
+    }
+    
+    return highPrecisionTimer->SetDispatchMode(mode);
+}
+
+bool AudiblizerTestHarness::SetAudioQueueDepth(double seconds)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    
+    if(audioQueueingThread != nullptr || seconds <= 0)
+    {
+        return false;
+    }
+    
+    maxQueuedAudioDurationSeconds = seconds;
+    queuedAudioLowWatermarkSeconds = seconds - std::min(seconds / 4.0, 0.25);
+    
+    return true;
+}
+
+bool AudiblizerTestHarness::SetTraceFile(const char *filePath)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    
+    if(dataOutputThread != nullptr)
+    {
+        return false;
+    }
+    
+    traceFilePath = filePath != nullptr ? filePath : "";
+    
+    return true;
+}
+
 bool AudiblizerTestHarness::StartTest(const VideoSegments &videoSegmentsArg, double adversarialTestingAudioPlayrateFactorArg, uint32_t adversarialTestingAudioChunkCacheSizeArg, uint32_t numAdversarialPressureTheads)
 {
     std::lock_guard<std::mutex> lock(mutex);
@@ -255,7 +356,8 @@ bool AudiblizerTestHarness::StartTest(const VideoSegments &videoSegmentsArg, dou
         return false;
     }
     
-    videoPlaymap.clear();
+    videoSegmentIndex.clear();
+    videoSegmentCursor = 0;
     videoSegmentOutputData.clear();
     videoSegments = videoSegmentsArg;
     adversarialTestingAudioPlayrateFactor = adversarialTestingAudioPlayrateFactorArg > 0 ? adversarialTestingAudioPlayrateFactorArg : -adversarialTestingAudioPlayrateFactorArg;
@@ -265,6 +367,8 @@ bool AudiblizerTestHarness::StartTest(const VideoSegments &videoSegmentsArg, dou
     audioPlaybackDurationActual = std::chrono::duration<double>::zero();
     audioPlaybackDurationIdeal = 0;
     firstCallToAudioChunkCompleted = false;
+    steadyStateAllocationBaseline = 0;
+    steadyStateAllocationBaselineTaken = false;
     audioDataPtr = audioData;
     audioChunkIter = 0;
     videoFrameIter = 0;
@@ -280,17 +384,29 @@ bool AudiblizerTestHarness::StartTest(const VideoSegments &videoSegmentsArg, dou
     videoSegmentsTotalNumFrames = 0;
     frameRateAdjustedOnFrameIndex = 0;
     videoSegmentOutputDataIter = 0;
+    audioChunkScheduleIter = 0;
+    if(virtualClock)
+    {
+        virtualClock->Set(Clock::TimePoint()); // such that every run starts out at the very same (virtual) time
+    }
+    loopbackFramesRendered = 0;
+    loopbackChecksum = 0xcbf29ce484222325ULL; // FNV-1a offset basis
+    loopbackWallClockSeconds = 0;
+    
+    loopbackCaptureMutex.lock();
+    loopbackCapturedAudio.clear();
+    loopbackCaptureMutex.unlock();
    
     // parse the video segments
+    videoSegmentIndex.reserve(videoSegments.size() + 1);
     for(uint32_t i = 0; i < videoSegments.size(); i++)
     {
-        // generate a video playmap using the video segments
+        // index the video segments
         // -------------------------------------------------------
         
-        // insert the segment with the ***current value*** of videoSegmentsTotalNumFrames,
-        // which is the starting video frame-index of this segment (as we use the value
-        // ***before*** we add to it the numFrames for *this* segment)
-        videoPlaymap.insert(VideoPlaymapPair(videoSegmentsTotalNumFrames, videoSegments[i]));
+        // the segment starts at the ***current value*** of videoSegmentsTotalNumFrames, as
+        // we use the value ***before*** we add to it the numFrames for *this* segment
+        videoSegmentIndex.push_back(VideoSegmentBoundary(videoSegmentsTotalNumFrames, videoSegments[i].sampleDuration, videoSegments[i].timeScale));
         
         // generate the total num frames in all the video segments
         videoSegmentsTotalNumFrames += videoSegments[i].numVideoFrames;
@@ -298,17 +414,65 @@ bool AudiblizerTestHarness::StartTest(const VideoSegments &videoSegmentsArg, dou
         // prepare a VideoSegmentsOutputData element for each segment
         videoSegmentOutputData.push_back(VideoSegmentOutputData());
     }
+    videoSegmentIndex.push_back(VideoSegmentBoundary(UINT64_MAX, 0, 0));
+    
+    // work out the audio for every video frame up front
+    if(!BuildAudioChunkSchedule(videoSegments, audioSampleRate, adversarialTestingAudioPlayrateFactor, audioChunkSchedule))
+    {
+        printf("ERROR: Failed to build audio chunk schedule!!!\n");
+        return false;
+    }
     
     // start the video timer off using the timing values for the first segment of video, also resetting the audioPlayrateFactor
-    videoTimerDelegate->SetTimerPeriod(videoPlaymap.begin()->second.sampleDuration / (double) videoPlaymap.begin()->second.timeScale);
+    videoTimerDelegate->SetTimerPeriod(videoSegmentIndex[0].sampleDuration, videoSegmentIndex[0].timeScale);
     videoTimerDelegate->SetAudioPlayrateFactor(1.0);
     
     // underscore that we used the frame rate of the first video segment
-    frameRateAdjustedOnFrameIndex = videoPlaymap.begin()->first;
+    frameRateAdjustedOnFrameIndex = videoSegmentIndex[0].firstFrame;
     
     // underscore that we are on the first video segment in the VideoSegmentsOutputData
     videoSegmentOutputDataIter = 0;
     
+    // room for a record per frame (a long test merely needs the output thread to keep up)
+    if(!outputDataRing.Allocate(std::min<uint64_t>(videoSegmentsTotalNumFrames + 64, 65536)))
+    {
+        printf("ERROR: Failed to allocate output data ring!!!\n");
+        return false;
+    }
+    outputDataDropped = 0;
+    
+    // open the binary trace (if there is to be one), leaving stdio to turn the output thread's batches into large writes
+    if(!traceFilePath.empty())
+    {
+        TraceFormat::TraceFileHeader traceFileHeader;
+        
+        traceFile = fopen(traceFilePath.c_str(), "wb");
+        if(traceFile == nullptr)
+        {
+            printf("Failed to open trace file!!! Error:%s\n", strerror(errno));
+            return false;
+        }
+        
+        setvbuf(traceFile, nullptr, _IOFBF, 1 << 20);
+        
+        traceFileHeader.recordSize = sizeof(TraceFormat::TraceRecord);
+        traceFileHeader.audioChunkCacheSize = adversarialTestingAudioChunkCacheSize;
+        traceFileHeader.totalNumFrames = videoSegmentsTotalNumFrames;
+        traceFileHeader.adversarialTestingAudioPlayrateFactor = adversarialTestingAudioPlayrateFactor;
+        
+        if(fwrite(&traceFileHeader, sizeof(traceFileHeader), 1, traceFile) != 1)
+        {
+            printf("Failed to write trace file header!!! Error:%s\n", strerror(errno));
+            fclose(traceFile);
+            traceFile = nullptr;
+            return false;
+        }
+        
+        traceBatch.reserve(DataOutputMaxBatchSize);
+        traceRecordsWritten = 0;
+        traceWriteFailed = false;
+    }
+    
     // start up the adversarial pressure threads (if there are any...)
     if(numAdversarialPressureTheads != 0)
     {
@@ -319,22 +483,30 @@ bool AudiblizerTestHarness::StartTest(const VideoSegments &videoSegmentsArg, dou
         }
     }
     
-    // start up the high precision timer
-    highPrecisionTimer->Start();
-    
-    audioQueueingThreadRunning = true;
-    audioQueueingThread = new (std::nothrow) std::thread(AudioQueueingThreadProc, this);
-    if(audioQueueingThread == nullptr)
-    {
-        audioQueueingThreadRunning = false;
-        return false;
-    }
-    
+    // start the data output thread ahead of anything that feeds it
     dataOutputThreadRunning = true;
     dataOutputThread = new (std::nothrow) std::thread(DataOutputThreadProc, this);
     if(dataOutputThread == nullptr)
     {
         dataOutputThreadRunning = false;
+        StopTestThreads();
+        return false;
+    }
+    
+    // start up the high precision timer (unless we are on a loopback device, in which
+    // case the loopback render thread fires the timer delegates in virtual time)
+    if(!virtualClock)
+    {
+        highPrecisionTimer->Start();
+    }
+    
+    audioQueueingThreadRunning = true;
+    audioQueueingThread = new (std::nothrow) std::thread(virtualClock ? LoopbackRenderThreadProc : AudioQueueingThreadProc, this);
+    if(audioQueueingThread == nullptr)
+    {
+        audioQueueingThreadRunning = false;
+        highPrecisionTimer->Stop();
+        StopTestThreads();
         return false;
     }
         
@@ -357,9 +529,19 @@ bool AudiblizerTestHarness::StopTest()
     
     // stop the threads
     // -------------------------------------
+    StopTestThreads();
+    
+    return true;
+}
+
+void AudiblizerTestHarness::StopTestThreads()
+{
+    // NOTE: 'mutex' is held by the caller. Stops whatever StartTest() got as far as starting (all of it,
+    //       in the case of StopTest()), and closes the trace file
     if(audioQueueingThread != nullptr)
     {
         audioQueueingThreadRunning = false;
+        audioQueueingThreadWake.Signal();
         audioQueueingThread->join();
         delete audioQueueingThread;
         audioQueueingThread = nullptr;
@@ -368,11 +550,26 @@ bool AudiblizerTestHarness::StopTest()
     if(dataOutputThread != nullptr)
     {
         dataOutputThreadRunning = false;
+        outputDataWake.Signal();
         dataOutputThread->join();
         delete dataOutputThread;
         dataOutputThread = nullptr;
     }
     
+    if(traceFile != nullptr)
+    {
+        if(fclose(traceFile) != 0 || traceWriteFailed)
+        {
+            printf("Failed to write trace file!!! Error:%s\n", strerror(errno));
+        }
+        else
+        {
+            printf("Trace file:%s records:%llu\n", traceFilePath.c_str(), (unsigned long long)traceRecordsWritten);
+        }
+        
+        traceFile = nullptr;
+    }
+    
     // stop the adversarial pressure threads
     // -------------------------------------
     if(!adversarialPressureThreads.empty())
@@ -384,8 +581,6 @@ bool AudiblizerTestHarness::StopTest()
         
         adversarialPressureThreads.clear();
     }
-    
-    return true;
 }
 
 void AudiblizerTestHarness::WaitOnTestCompletion()
@@ -403,14 +598,20 @@ void AudiblizerTestHarness::AudioChunkCompleted(const AudioChunkCompletedVector
         return;
     }
     
+    // wake the queueing thread as soon as there is room to top the queue back off (or once it has drained)
+    if(audiblizer->QueuedAudioDurationSeconds() <= queuedAudioLowWatermarkSeconds)
+    {
+        audioQueueingThreadWake.Signal();
+    }
+    
     if(!firstCallToAudioChunkCompleted)
     {
-        lastCallToAudioChunkCompleted = std::chrono::high_resolution_clock::now();
+        lastCallToAudioChunkCompleted = Now();
         firstCallToAudioChunkCompleted = true;
     }
     else
     {
-        std::chrono::high_resolution_clock::time_point now = std::chrono::high_resolution_clock::now();
+        Clock::TimePoint now = Now();
         audioPlaybackDurationActual += (now - lastCallToAudioChunkCompleted);
         
         for(uint32_t i = 0; i < audioChunksCompleted.size(); i++)
@@ -419,6 +620,14 @@ void AudiblizerTestHarness::AudioChunkCompleted(const AudioChunkCompletedVector
         }
         
         lastCallToAudioChunkCompleted = now;
+        
+        // once a full queue's worth of audio has been played out, every buffer, record and completion
+        // slot the Audiblizer will ever need has been touched, so from here on it should never allocate
+        if(!steadyStateAllocationBaselineTaken && audioPlaybackDurationIdeal >= maxQueuedAudioDurationSeconds)
+        {
+            steadyStateAllocationBaseline = AllocationTracker::Count();
+            steadyStateAllocationBaselineTaken = true;
+        }
     }
     
     adversarialTestingAudioChunkCacheAccum += (int32_t)audioChunksCompleted.size();
@@ -443,6 +652,29 @@ void AudiblizerTestHarness::AudioChunkCompleted(const AudioChunkCompletedVector
     return;
 }
 
+size_t AudiblizerTestHarness::VideoSegmentForFrame(uint64_t frame)
+{
+    // NOTE: the last entry is a sentinel, so there is always an entry after the cursor
+    
+    // still within the current segment
+    if(frame >= videoSegmentIndex[videoSegmentCursor].firstFrame && frame < videoSegmentIndex[videoSegmentCursor + 1].firstFrame)
+    {
+        return videoSegmentCursor;
+    }
+    
+    // on to the next segment
+    if(videoSegmentCursor + 2 < videoSegmentIndex.size() && frame >= videoSegmentIndex[videoSegmentCursor + 1].firstFrame && frame < videoSegmentIndex[videoSegmentCursor + 2].firstFrame)
+    {
+        return ++videoSegmentCursor;
+    }
+    
+    // anywhere else, the last segment that starts at or before the frame
+    VideoSegmentIndex::iterator iter = std::upper_bound(videoSegmentIndex.begin(), videoSegmentIndex.end() - 1, VideoSegmentBoundary(frame, 0, 0));
+    videoSegmentCursor = (size_t)(iter - videoSegmentIndex.begin()) - 1;
+    
+    return videoSegmentCursor;
+}
+
 void AudiblizerTestHarness::VideoTimerPing()
 {
     std::lock_guard<std::mutex> lock(mutex);
@@ -458,9 +690,9 @@ void AudiblizerTestHarness::VideoTimerPing()
 
 void AudiblizerTestHarness::PumpVideoFrame(PumpVideoFrameSender sender, int32_t numPumps)
 {
-    std::chrono::high_resolution_clock::time_point now = std::chrono::high_resolution_clock::now();
-    std::chrono::duration<float> deltaFloatingPointSeconds = now - lastCallToPumpVideoFrame;
-    std::chrono::duration<float> totalFloatingPointSeconds = now - playbackStart;
+    Clock::TimePoint now = Now();
+    std::chrono::duration<double> deltaFloatingPointSeconds = now - lastCallToPumpVideoFrame;
+    std::chrono::duration<double> totalFloatingPointSeconds = now - playbackStart;
     uint64_t numActionablePumps = numPumps; // num pumps that we are actually going to act upon within this call
     OutputData outputData;
     bool adjustedFramerate = false;
@@ -521,7 +753,7 @@ void AudiblizerTestHarness::PumpVideoFrame(PumpVideoFrameSender sender, int32_t
                 numActionablePumps = abs(avEqualizer); // we only act on the remainder of pumps
                 videoFrameIter += numActionablePumps;
                 avEqualizer = 0;
-                videoTimerDelegate->RefreshLastPing();
+                videoTimerDelegate->LastPing(Now());
                 
                 // reset the accum that tracks audio running slower than video
                 audioRunningSlowAccum = 0;
@@ -571,7 +803,7 @@ void AudiblizerTestHarness::PumpVideoFrame(PumpVideoFrameSender sender, int32_t
                     
                     // update the audioPlayrateFactor in the Video Timer and refresh the timer ping
                     videoTimerDelegate->SetAudioPlayrateFactor(audioPlayrateFactor);
-                    videoTimerDelegate->RefreshLastPing();
+                    videoTimerDelegate->LastPing(Now());
                     
                     // reset the accum that tracks audio running slower than video
                     audioRunningSlowAccum = 0;
@@ -590,44 +822,19 @@ void AudiblizerTestHarness::PumpVideoFrame(PumpVideoFrameSender sender, int32_t
     }
     
     // If playback is multiframerate, then adjust the video timer period as necessary
-    if(videoPlaymap.size() > 1)
+    if(videoSegmentIndex.size() > 2)
     {
         // find the segment for the NEXT videoFrameIter
-        VideoPlaymapIterator iter = videoPlaymap.lower_bound(videoFrameIter);
-        if(iter == videoPlaymap.end())
-        {
-            iter--;
-        }
-        
-        // advance to the next segment
-        // Note: lower_bound() does not do exactly what we want, nor does upper_bound.
-        //       We want an iterator to the value that meets the following criterias:
-        //          1) the returned iterator will point to the element whose key
-        //             is equal to or less than 'videoFrameIter'
-        //          AND
-        //          2) 'videoFrameIter' is strictly less than the key of the
-        //             element in the map that follows the chosen element
-        //
-        // Thus: if keys are {0, 900}, and we are given a value of 0, we return the first
-        //       element. If we are given 1, we return the first element. If we are given
-        //       900, we return the second element. If we are given 901, we return the
-        //       second element.
-        //
-        // The closest thing is to use lower_bound() and then decrement the iterator
-        // if its key is greater than the value that we used in the lower_bound() search
-        if(iter->first > videoFrameIter)
-        {
-            iter--;
-        }
+        const VideoSegmentBoundary &segment = videoSegmentIndex[VideoSegmentForFrame(videoFrameIter)];
         
         // if we should perform a new adjustment
-        if(frameRateAdjustedOnFrameIndex != iter->first)
+        if(frameRateAdjustedOnFrameIndex != segment.firstFrame)
         {
             // update the video timer period
-            videoTimerDelegate->SetTimerPeriod(iter->second.sampleDuration / (double) iter->second.timeScale);
+            videoTimerDelegate->SetTimerPeriod(segment.sampleDuration, segment.timeScale);
             
             // keep track of on which video frame the adjustment took place
-            frameRateAdjustedOnFrameIndex = iter->first;
+            frameRateAdjustedOnFrameIndex = segment.firstFrame;
             
             // note that we adjusted frame rate
             adjustedFramerate = true;
@@ -649,7 +856,7 @@ void AudiblizerTestHarness::PumpVideoFrame(PumpVideoFrameSender sender, int32_t
     if(!firstCallToPumpVideoFrame)
     {
         firstCallToPumpVideoFrame = true;
-        lastCallToPumpVideoFrame = std::chrono::high_resolution_clock::now();
+        lastCallToPumpVideoFrame = Now();
         playbackStart = lastCallToPumpVideoFrame;
         return;
     }
@@ -661,7 +868,7 @@ void AudiblizerTestHarness::PumpVideoFrame(PumpVideoFrameSender sender, int32_t
         return;
     }
     
-    now = std::chrono::high_resolution_clock::now();
+    now = Now();
     deltaFloatingPointSeconds = now - lastCallToPumpVideoFrame;
     totalFloatingPointSeconds = now - playbackStart;
     
@@ -676,10 +883,13 @@ void AudiblizerTestHarness::PumpVideoFrame(PumpVideoFrameSender sender, int32_t
     outputData.videoFrameIter = videoFrameIter;
     outputData.deltaFloatingPointSeconds = deltaFloatingPointSeconds;
     outputData.totalFloatingPointSeconds = totalFloatingPointSeconds;
+    outputData.audioPositionSeconds = audiblizer->PlaybackPosition().nanoseconds / 1000000000.0;
     
-    outputDataQueueMutex.lock();
-    outputDataQueue.push(outputData);
-    outputDataQueueMutex.unlock();
+    if(!outputDataRing.Push(outputData))
+    {
+        outputDataDropped.fetch_add(1, std::memory_order_relaxed);
+    }
+    outputDataWake.Signal();
     
     lastCallToPumpVideoFrame = now;
     videoSegmentOutputData[videoSegmentOutputDataIter].cumulativeDelta += deltaFloatingPointSeconds;
@@ -728,13 +938,9 @@ Exit:
 
 void AudiblizerTestHarness::AudioQueueingThreadProc(AudiblizerTestHarness *audiblizerTestHarness)
 {
-    uint32_t videoSegmentIter = 0;
-    uint32_t videoSegmentFrameIter = 0;
-    double   remainder = 0;
-    
-    std::string outputDataString;
-    const uint32_t outputDataCStringSize = 512;
-    char outputDataCString [outputDataCStringSize];
+    // NOTE: the thread is woken by completions (see AudioChunkCompleted()), so this is merely a safety net
+    //       should a completion ever go missing
+    const std::chrono::milliseconds wakeTimeout(100);
     
     while(true)
     {
@@ -744,7 +950,7 @@ void AudiblizerTestHarness::AudioQueueingThreadProc(AudiblizerTestHarness *audib
         }
         
         // ensure that we are still in valid territory
-        if(videoSegmentIter >= audiblizerTestHarness->videoSegments.size())
+        if(audiblizerTestHarness->AllAudioQueued())
         {
             break;
         }
@@ -753,185 +959,493 @@ void AudiblizerTestHarness::AudioQueueingThreadProc(AudiblizerTestHarness *audib
         double queuedAudioDurationSeconds = audiblizerTestHarness->audiblizer->QueuedAudioDurationSeconds();
         double maxDurationToBeQueued = audiblizerTestHarness->maxQueuedAudioDurationSeconds - queuedAudioDurationSeconds;
         
-        // if the audiblizer is close to being overloaded, sleep for a bit
-        if(maxDurationToBeQueued <= 0.25)
+        // if the queue is still above its low watermark, sleep until completions drain it below
+        if(queuedAudioDurationSeconds > audiblizerTestHarness->queuedAudioLowWatermarkSeconds)
         {
-            std::this_thread::sleep_for(std::chrono::milliseconds(500));
+            audiblizerTestHarness->audioQueueingThreadWake.Wait(wakeTimeout);
             continue;
         }
         
-        // queue as much audio as we are able to
-        // --------------------------------------------------
-        int32_t queueableAudioDurationMilliseconds = maxDurationToBeQueued * 1000.0;
-        Audiblizer::AudioChunkVector audioChunks;
-        
-        while(queueableAudioDurationMilliseconds > 0)
+        // NOTE: always queues at least a video frame's worth, however little room there is, so that even a queue
+        //       depth of less than two frames tops itself back off. Should the Audiblizer refuse the audio, wait
+        //       rather than spin, as nothing will have changed
+        if(!audiblizerTestHarness->QueueAudioChunks(maxDurationToBeQueued))
+        {
+            audiblizerTestHarness->audioQueueingThreadWake.Wait(wakeTimeout);
+        }
+    }
+    
+    // wait for audiblizer buffers to drain (or for the test to be stopped)
+    // ------------------------------------------------------------
+    while(audiblizerTestHarness->audioQueueingThreadRunning && audiblizerTestHarness->audiblizer->NumBuffersQueued() > 0)
+    {
+        audiblizerTestHarness->audioQueueingThreadWake.Wait(wakeTimeout);
+    }
+    
+    // as audiblizer drives the heart beat, we can output end-of-test data here
+    // -------------------------------------
+    audiblizerTestHarness->OutputEndOfTestData();
+    
+    // tell topside that thread completed
+    // ------------------------------------------------------------
+    audiblizerTestHarness->audioQueueingThreadTerminated.Signal();
+}
+
+void AudiblizerTestHarness::LoopbackRenderThreadProc(AudiblizerTestHarness *audiblizerTestHarness)
+{
+    std::shared_ptr<Audiblizer> audiblizer = audiblizerTestHarness->audiblizer;
+    std::shared_ptr<VideoTimerDelegate> videoTimerDelegate = audiblizerTestHarness->videoTimerDelegate;
+    std::shared_ptr<HighPrecisionTimer> highPrecisionTimer = audiblizerTestHarness->highPrecisionTimer;
+    std::shared_ptr<VirtualClock> virtualClock = audiblizerTestHarness->virtualClock;
+    std::chrono::steady_clock::time_point wallClockStart = std::chrono::steady_clock::now();
+    Clock::TimePoint nextDeadline;
+    bool scheduled;
+    
+    // render in quanta of no more than 10ms, so that completed audio is noticed in a timely manner
+    const uint32_t sampleRate = audiblizer->LoopbackSampleRate();
+    const uint32_t maxRenderFrames = sampleRate / 100;
+    std::vector<int16_t> renderBuffer(maxRenderFrames * 2);
+    
+    // the timer delegates start out on the virtual clock's epoch
+    // NOTE: a timer on a virtual clock is never Start()ed, rather it is Step()ped each time the clock is advanced
+    audiblizer->LastPing(audiblizerTestHarness->Now());
+    videoTimerDelegate->LastPing(audiblizerTestHarness->Now());
+    scheduled = highPrecisionTimer->Step(nextDeadline);
+    
+    while(audiblizerTestHarness->audioQueueingThreadRunning)
+    {
+        // keep the audiblizer topped off exactly as the audio queueing thread would
+        // ------------------------------------------------------------
+        if(!audiblizerTestHarness->AllAudioQueued())
         {
-            if(videoSegmentFrameIter >= audiblizerTestHarness->videoSegments[videoSegmentIter].numVideoFrames)
+            double maxDurationToBeQueued = audiblizerTestHarness->maxQueuedAudioDurationSeconds - audiblizer->QueuedAudioDurationSeconds();
+            if(audiblizer->QueuedAudioDurationSeconds() <= audiblizerTestHarness->queuedAudioLowWatermarkSeconds)
             {
-                videoSegmentFrameIter = 0;
-                videoSegmentIter++;
+                audiblizerTestHarness->QueueAudioChunks(maxDurationToBeQueued);
             }
-            
-            if(videoSegmentIter >= audiblizerTestHarness->videoSegments.size())
+        }
+        else if(audiblizer->NumBuffersQueued() == 0)
+        {
+            break;
+        }
+        
+        // render up until the timer is next due
+        // ------------------------------------------------------------
+        uint32_t renderFrames = maxRenderFrames;
+        if(scheduled)
+        {
+            std::chrono::duration<double> untilDeadline = nextDeadline - audiblizerTestHarness->Now();
+            renderFrames = untilDeadline.count() > 0 ? (uint32_t)std::ceil(untilDeadline.count() * sampleRate) : 1;
+            renderFrames = std::max(1U, std::min(renderFrames, maxRenderFrames));
+        }
+        
+        if(!audiblizer->RenderLoopback(renderBuffer.data(), renderFrames))
+        {
+            printf("ERROR: RenderLoopback!!!\n");
+            break;
+        }
+        
+        const uint8_t *renderedBytes = (const uint8_t*) renderBuffer.data();
+        for(size_t i = 0; i < renderFrames * 2 * sizeof(int16_t); i++)
+        {
+            audiblizerTestHarness->loopbackChecksum = (audiblizerTestHarness->loopbackChecksum ^ renderedBytes[i]) * 0x100000001b3ULL;
+        }
+        
+        audiblizerTestHarness->loopbackCaptureMutex.lock();
+        if(audiblizerTestHarness->loopbackCapture)
+        {
+            audiblizerTestHarness->loopbackCapturedAudio.insert(audiblizerTestHarness->loopbackCapturedAudio.end(), renderBuffer.begin(), renderBuffer.begin() + renderFrames * 2);
+        }
+        audiblizerTestHarness->loopbackCaptureMutex.unlock();
+        
+        // advance the virtual clock to the end of what has been rendered
+        // NOTE: the clock is derived from the total frame count (rather than accumulated per render)
+        //       such that it never drifts from the audio, and only ever advances in whole frames
+        audiblizerTestHarness->loopbackFramesRendered += renderFrames;
+        virtualClock->Set(Clock::TimePoint(std::chrono::nanoseconds((int64_t)((audiblizerTestHarness->loopbackFramesRendered * 1000000000ULL) / sampleRate))));
+        
+        // fire whichever timer delegates are now due in virtual time
+        // ------------------------------------------------------------
+        scheduled = highPrecisionTimer->Step(nextDeadline);
+    }
+    
+    audiblizerTestHarness->loopbackWallClockSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallClockStart).count();
+    
+    audiblizerTestHarness->OutputEndOfTestData();
+    
+    // tell topside that thread completed
+    // ------------------------------------------------------------
+    audiblizerTestHarness->audioQueueingThreadTerminated.Signal();
+}
+
+bool AudiblizerTestHarness::CheckedMultiply(uint64_t a, uint64_t b, uint64_t &product)
+{
+    if(a != 0 && b > UINT64_MAX / a)
+    {
+        return false;
+    }
+    
+    product = a * b;
+    return true;
+}
+
+bool AudiblizerTestHarness::FrameStep(uint64_t sampleDuration, uint64_t sampleRate, uint64_t factorNumerator, uint64_t denominatorScale, uint64_t &step)
+{
+    return CheckedMultiply(sampleDuration, sampleRate, step) &&
+           CheckedMultiply(step, factorNumerator, step) &&
+           CheckedMultiply(step, denominatorScale, step);
+}
+
+bool AudiblizerTestHarness::BuildAudioChunkSchedule(const VideoSegments &segments, uint32_t sampleRate, double playrateFactor, AudioChunkSchedule &schedule)
+{
+    schedule.clear();
+    
+    if(sampleRate == 0 || playrateFactor <= 0)
+    {
+        return false;
+    }
+    
+    // for *** test purposes only *** we allow for the audio per video frame to be scaled by
+    // 'playrateFactor', which allows us to mimic a system that plays audio either too fast or
+    // too slow as compared to the explicit audio sample rate. It is taken to the nearest millionth,
+    // such that the rate stays rational
+    const uint64_t factorDenominator = playrateFactor == 1.0 ? 1 : 1000000;
+    const uint64_t factorNumerator = (uint64_t)std::llround(playrateFactor * factorDenominator);
+    
+    // the position in the test is kept as 'wholeSamples' + (fraction / denominator), where the denominator
+    // is the least common multiple of every segment's timeScale seen so far (times that of the factor)
+    uint64_t wholeSamples = 0;
+    uint64_t fraction = 0;
+    uint64_t denominator = factorDenominator;
+    size_t   numVideoFrames = 0;
+    
+    for(uint32_t i = 0; i < segments.size(); i++)
+    {
+        numVideoFrames += segments[i].numVideoFrames;
+    }
+    
+    schedule.reserve(numVideoFrames);
+    
+    for(uint32_t i = 0; i < segments.size(); i++)
+    {
+        const VideoParameters &segment = segments[i];
+        
+        if(segment.timeScale == 0 || segment.sampleDuration == 0)
+        {
+            schedule.clear();
+            return false;
+        }
+        
+        // move the fraction over to a denominator that the segment's timeScale divides evenly into
+        uint64_t timeScale = 0;
+        if(!CheckedMultiply(segment.timeScale, factorDenominator, timeScale))
+        {
+            schedule.clear();
+            return false;
+        }
+        
+        uint64_t a = denominator;
+        uint64_t b = timeScale;
+        while(b != 0)
+        {
+            uint64_t t = a % b;
+            a = b;
+            b = t;
+        }
+        
+        // one video frame is sampleDuration * sampleRate * factor / timeScale samples, i.e. 'step' / denominator
+        uint64_t scale = timeScale / a;
+        uint64_t scaledDenominator = 0;
+        uint64_t step = 0;
+        
+        if(CheckedMultiply(denominator, scale, scaledDenominator) &&
+           FrameStep(segment.sampleDuration, sampleRate, factorNumerator, scaledDenominator / timeScale, step))
+        {
+            fraction *= scale; // fraction < denominator, so this fits if the denominator did
+            denominator = scaledDenominator;
+        }
+        else
+        {
+            // the lcm of the timeScales (e.g. 30000, 44100 and 23976, in millionths) no longer fits in 64 bits, so
+            // start over from the segment's own timeScale, rounding the fraction to the nearest 1 / timeScale of a
+            // sample. The schedule stays exact within each segment, and is off by less than a sample overall
+            fraction = (uint64_t)std::llround(fraction / (double)denominator * timeScale);
+            denominator = timeScale;
+            if(fraction >= denominator)
             {
-                break;
+                wholeSamples++;
+                fraction -= denominator;
             }
             
-            // derive info on video frames remaining in current video segment
-            uint32_t numVideoFramesRemaining = audiblizerTestHarness->videoSegments[videoSegmentIter].numVideoFrames - videoSegmentFrameIter;
-            uint32_t videoFrameDurationMilliseconds = (audiblizerTestHarness->videoSegments[videoSegmentIter].sampleDuration * 1000) / audiblizerTestHarness->videoSegments[videoSegmentIter].timeScale;
-            uint32_t numVideoFramesRemainingDurationMilliseconds = numVideoFramesRemaining * videoFrameDurationMilliseconds;
-            
-            // derive info on the audio
-            double   audioFramesPerVideoFrame = (audiblizerTestHarness->videoSegments[videoSegmentIter].sampleDuration / (double) audiblizerTestHarness->videoSegments[videoSegmentIter].timeScale) * audiblizerTestHarness->audioSampleRate;
-            uint32_t audioFrameByteLength = Audiblizer::AudioFormatFrameByteLength(audiblizerTestHarness->audioFormat);
-            
-            // for *** test purposes only *** we allow for the value of audioFramesPerVideoFrame to
-            // be scaled by 'audioPlayrateFactor', which allows us to mimic a system that plays
-            // audio either too fast or too slow as compared to the explicit audio sample rate
-            audioFramesPerVideoFrame *= audiblizerTestHarness->adversarialTestingAudioPlayrateFactor;
-            
-            // derive how much audio that we will here be queueing from the CURRENT video segment
-            uint32_t currentChunkMilliseconds = queueableAudioDurationMilliseconds;
-            if(currentChunkMilliseconds > numVideoFramesRemainingDurationMilliseconds)
+            if(!FrameStep(segment.sampleDuration, sampleRate, factorNumerator, 1, step))
             {
-                currentChunkMilliseconds = numVideoFramesRemainingDurationMilliseconds;
+                printf("ERROR: Video segment:%u frame duration is too large to schedule audio for!!!\n", i);
+                schedule.clear();
+                return false;
             }
+        }
+        
+        uint64_t stepWhole = step / denominator;
+        uint64_t stepFraction = step % denominator;
+        
+        // the chunk for a single frame has to fit the schedule's 32-bit sample count
+        if(stepWhole >= UINT32_MAX)
+        {
+            printf("ERROR: Video segment:%u frame duration is too large to schedule audio for!!!\n", i);
+            schedule.clear();
+            return false;
+        }
+        
+        for(uint32_t j = 0; j < segment.numVideoFrames; j++)
+        {
+            uint64_t startSample = wholeSamples;
             
-            // finally derive the number of video frames that we will be queueing from the CURRENT video segment
-            uint32_t numVideoFramesToQueue = currentChunkMilliseconds / videoFrameDurationMilliseconds;
-            
-            // acutally create the audio chunks and place them into the the audioChunksVector
-            for(uint32_t i = 0; i < numVideoFramesToQueue; i++)
+            wholeSamples += stepWhole;
+            fraction += stepFraction;
+            if(fraction >= denominator)
             {
-                Audiblizer::AudioChunk audioChunk;
-                
-                // see if we have to add any extra audio frames due to the remainder
-                remainder += (audioFramesPerVideoFrame - (uint32_t)audioFramesPerVideoFrame);
-                
-                uint32_t remainderAdd = 0;
-                if(remainder > 1.0)
-                {
-                    remainderAdd = 1;
-                    remainder -= 1.0;
-                }
-                
-                uint32_t totalAudioFrames = ((uint32_t)audioFramesPerVideoFrame) + remainderAdd;
-                uint32_t totalAudioFramesByteLength = totalAudioFrames * audioFrameByteLength;
-                
-                // failsafe to not try to make a queue of audio that is longer that the
-                // entire buffer of sample audio. As this should never happen in production,
-                // and should never even happen here in this test WE DO NOT MESS AROUND
-                // WITH remainder, WHICH WE SHOULD DO IF HITTING THIS CONDITION WERE TO
-                // BE A REAL POSSIBILITY
-                if(totalAudioFramesByteLength > audiblizerTestHarness->audioDataSize)
-                {
-                    totalAudioFrames = (uint32_t)(audiblizerTestHarness->audioDataSize / audioFrameByteLength);
-                    totalAudioFramesByteLength = totalAudioFrames * audioFrameByteLength;
-                }
-                
-                // if the current chunk would take us past the end of the sample audio, then reset the pointer
-                size_t currentAudioByteLocation = audiblizerTestHarness->audioDataPtr - audiblizerTestHarness->audioData;
-                if(currentAudioByteLocation + (totalAudioFrames * audioFrameByteLength) >= audiblizerTestHarness->audioDataSize)
-                {
-                    audiblizerTestHarness->audioDataPtr = audiblizerTestHarness->audioData;
-                }
-                
-                // fill up the audio chunk
-                audioChunk.buffer = audiblizerTestHarness->audioDataPtr;
-                audioChunk.bufferSize = totalAudioFramesByteLength;
-                audioChunk.format = audiblizerTestHarness->audioFormat;
-                audioChunk.sampleRate = audiblizerTestHarness->audioSampleRate;
-                
-                // advance the audioDataPtr
-                audiblizerTestHarness->audioDataPtr += totalAudioFramesByteLength;
-                
-                // push the chunk onto the audioChunks vector
-                audioChunks.push_back(audioChunk);
+                wholeSamples++;
+                fraction -= denominator;
             }
             
-            // keep track of how much audio we just added to the audioChunks vector
-            videoSegmentFrameIter += numVideoFramesToQueue;
-            
-            // remove the amount that we just queued
-            queueableAudioDurationMilliseconds -= currentChunkMilliseconds;
+            schedule.push_back(AudioChunkScheduleEntry(startSample, (uint32_t)(wholeSamples - startSample)));
         }
+    }
+    
+    return true;
+}
+
+bool AudiblizerTestHarness::QueueAudioChunks(double maxDurationToBeQueued)
+{
+    // queue as much audio as we are able to, a whole video frame's worth at a time
+    // --------------------------------------------------
+    uint64_t queueableSamples = (uint64_t)(maxDurationToBeQueued * audioSampleRate);
+    uint32_t audioFrameByteLength = Audiblizer::AudioFormatFrameByteLength(audioFormat);
+    Audiblizer::AudioChunkVector audioChunks;
+    
+    while(audioChunkScheduleIter < audioChunkSchedule.size() && (audioChunkSchedule[audioChunkScheduleIter].numSamples <= queueableSamples || audioChunks.empty()))
+    {
+        Audiblizer::AudioChunk audioChunk;
+        
+        uint32_t totalAudioFrames = audioChunkSchedule[audioChunkScheduleIter].numSamples;
+        uint32_t totalAudioFramesByteLength = totalAudioFrames * audioFrameByteLength;
         
-        // queue the (valid) audioChunk onto the audiblizer
-        if(audioChunks.size() > 0)
+        // NOTE: a queue depth of less than a video frame still gets a frame at a time
+        queueableSamples -= std::min(queueableSamples, (uint64_t)totalAudioFrames);
+        audioChunkScheduleIter++;
+        
+        // failsafe to not try to make a queue of audio that is longer that the
+        // entire buffer of sample audio. As this should never happen in production,
+        // and should never even happen here in this test WE DO NOT MESS AROUND
+        // WITH THE SCHEDULE, WHICH WE SHOULD DO IF HITTING THIS CONDITION WERE TO
+        // BE A REAL POSSIBILITY
+        if(totalAudioFramesByteLength > audioDataSize)
         {
-            audiblizerTestHarness->audiblizer->QueueAudio(audioChunks);
+            totalAudioFrames = (uint32_t)(audioDataSize / audioFrameByteLength);
+            totalAudioFramesByteLength = totalAudioFrames * audioFrameByteLength;
         }
+        
+        // if the current chunk would take us past the end of the sample audio, then reset the pointer
+        size_t currentAudioByteLocation = audioDataPtr - audioData;
+        if(currentAudioByteLocation + (totalAudioFrames * audioFrameByteLength) >= audioDataSize)
+        {
+            audioDataPtr = audioData;
+        }
+        
+        // fill up the audio chunk
+        audioChunk.buffer = audioDataPtr;
+        audioChunk.bufferSize = totalAudioFramesByteLength;
+        audioChunk.format = audioFormat;
+        audioChunk.sampleRate = audioSampleRate;
+        
+        // advance the audioDataPtr
+        audioDataPtr += totalAudioFramesByteLength;
+        
+        // push the chunk onto the audioChunks vector
+        audioChunks.push_back(audioChunk);
     }
     
-    // spin wait for audiblizer buffers to drain
-    // ------------------------------------------------------------
-    while(audiblizerTestHarness->audiblizer->NumBuffersQueued() > 0)
+    // queue the (valid) audioChunk onto the audiblizer
+    if(audioChunks.size() > 0)
     {
-        std::this_thread::sleep_for(std::chrono::milliseconds(500));
+        return audiblizer->QueueAudio(audioChunks);
     }
     
-    // as audiblizer drives the heart beat, we can output end-of-test data here
-    // -------------------------------------
+    return false;
+}
+
+void AudiblizerTestHarness::OutputEndOfTestData()
+{
+    std::string outputDataString;
+    const uint32_t outputDataCStringSize = 512;
+    char outputDataCString [outputDataCStringSize];
+    
     outputDataString += "*** TestStopped ***\n";
     
-    if(audiblizerTestHarness->adversarialTestingAudioPlayrateFactor != 1.0)
+    if(adversarialTestingAudioPlayrateFactor != 1.0)
     {
         memset(outputDataCString, 0, outputDataCStringSize);
-        sprintf(outputDataCString, "Adversarial AudioPlayrateFactor:%f\n", audiblizerTestHarness->adversarialTestingAudioPlayrateFactor);
+        sprintf(outputDataCString, "Adversarial AudioPlayrateFactor:%f\n", adversarialTestingAudioPlayrateFactor);
         outputDataString += outputDataCString;
     }
     
-    if(audiblizerTestHarness->audioPlayrateFactor != 1.0)
+    if(audioPlayrateFactor != 1.0)
     {
         memset(outputDataCString, 0, outputDataCStringSize);
-        sprintf(outputDataCString, "Actual AudioPlayrateFactor:%f\n", audiblizerTestHarness->audioPlayrateFactor);
+        sprintf(outputDataCString, "Actual AudioPlayrateFactor:%f\n", audioPlayrateFactor);
         outputDataString += outputDataCString;
     }
     
-    if(audiblizerTestHarness->adversarialTestingAudioChunkCacheSize != 1)
+    if(adversarialTestingAudioChunkCacheSize != 1)
     {
         memset(outputDataCString, 0, outputDataCStringSize);
-        sprintf(outputDataCString, "Adversarial AudioChunkCacheSize:%d\n", audiblizerTestHarness->adversarialTestingAudioChunkCacheSize);
+        sprintf(outputDataCString, "Adversarial AudioChunkCacheSize:%d\n", adversarialTestingAudioChunkCacheSize);
         outputDataString += outputDataCString;
     }
     
-    if(audiblizerTestHarness->adversarialPressureThreads.size() != 0)
+    if(adversarialPressureThreads.size() != 0)
     {
         memset(outputDataCString, 0, outputDataCStringSize);
-        sprintf(outputDataCString, "Adversarial PressureThreads count:%zu\n", audiblizerTestHarness->adversarialPressureThreads.size());
+        sprintf(outputDataCString, "Adversarial PressureThreads count:%zu\n", adversarialPressureThreads.size());
         outputDataString += outputDataCString;
     }
     
-    if(audiblizerTestHarness->videoSegmentOutputDataIter == 0)
+    if(!audioChunkSchedule.empty())
     {
+        double videoDurationSamples = 0;
+        for(uint32_t i = 0; i < videoSegments.size(); i++)
+        {
+            videoDurationSamples += videoSegments[i].numVideoFrames * (videoSegments[i].sampleDuration / (double)videoSegments[i].timeScale) * audioSampleRate * adversarialTestingAudioPlayrateFactor;
+        }
+        
         memset(outputDataCString, 0, outputDataCStringSize);
-        sprintf(outputDataCString, "VideoTimerPeriod:%f\n", audiblizerTestHarness->videoSegmentOutputData[0].timerPeriod);
+        sprintf(outputDataCString, "AudioChunkSchedule samples:%llu - video duration samples:%f\n", audioChunkSchedule.back().startSample + audioChunkSchedule.back().numSamples, videoDurationSamples);
+        outputDataString += outputDataCString;
+    }
+    
+    if(videoSegmentOutputDataIter == 0)
+    {
+        memset(outputDataCString, 0, outputDataCStringSize);
+        sprintf(outputDataCString, "VideoTimerPeriod:%f\n", videoSegmentOutputData[0].timerPeriod);
         outputDataString += outputDataCString;
         
         memset(outputDataCString, 0, outputDataCStringSize);
-        sprintf(outputDataCString, "Average Delta sec:%f - Max Delta sec:%f VFI:%06llu - Min Delta sec:%f VFI:%06llu\n", audiblizerTestHarness->videoSegmentOutputData[0].cumulativeDelta.count() / (double)audiblizerTestHarness->videoSegmentOutputData[0].numPumpsCompleted, audiblizerTestHarness->videoSegmentOutputData[0].maxDelta.count(), audiblizerTestHarness->videoSegmentOutputData[0].maxDeltaVideoFrameIter, audiblizerTestHarness->videoSegmentOutputData[0].minDelta.count(), audiblizerTestHarness->videoSegmentOutputData[0].minDeltaVideoFrameIter);
+        sprintf(outputDataCString, "Average Delta sec:%f - Max Delta sec:%f VFI:%06llu - Min Delta sec:%f VFI:%06llu\n", videoSegmentOutputData[0].cumulativeDelta.count() / (double)videoSegmentOutputData[0].numPumpsCompleted, videoSegmentOutputData[0].maxDelta.count(), videoSegmentOutputData[0].maxDeltaVideoFrameIter, videoSegmentOutputData[0].minDelta.count(), videoSegmentOutputData[0].minDeltaVideoFrameIter);
         outputDataString += outputDataCString;
     }
     else
     {
-        for(uint32_t i = 0; i <= audiblizerTestHarness->videoSegmentOutputDataIter; i++)
+        for(uint32_t i = 0; i <= videoSegmentOutputDataIter; i++)
         {
             memset(outputDataCString, 0, outputDataCStringSize);
-            sprintf(outputDataCString, "VideoSegment:%d  VideoTimerPeriod:%f\n", i, audiblizerTestHarness->videoSegmentOutputData[i].timerPeriod);
+            sprintf(outputDataCString, "VideoSegment:%d  VideoTimerPeriod:%f\n", i, videoSegmentOutputData[i].timerPeriod);
             outputDataString += outputDataCString;
             
             memset(outputDataCString, 0, outputDataCStringSize);
-            sprintf(outputDataCString, "VideoSegment:%d  Average Delta sec:%f - Max Delta sec:%f VFI:%06llu - Min Delta sec:%f VFI:%06llu\n", i, audiblizerTestHarness->videoSegmentOutputData[i].cumulativeDelta.count() / (double)audiblizerTestHarness->videoSegmentOutputData[i].numPumpsCompleted, audiblizerTestHarness->videoSegmentOutputData[i].maxDelta.count(), audiblizerTestHarness->videoSegmentOutputData[i].maxDeltaVideoFrameIter, audiblizerTestHarness->videoSegmentOutputData[i].minDelta.count(), audiblizerTestHarness->videoSegmentOutputData[i].minDeltaVideoFrameIter);
+            sprintf(outputDataCString, "VideoSegment:%d  Average Delta sec:%f - Max Delta sec:%f VFI:%06llu - Min Delta sec:%f VFI:%06llu\n", i, videoSegmentOutputData[i].cumulativeDelta.count() / (double)videoSegmentOutputData[i].numPumpsCompleted, videoSegmentOutputData[i].maxDelta.count(), videoSegmentOutputData[i].maxDeltaVideoFrameIter, videoSegmentOutputData[i].minDelta.count(), videoSegmentOutputData[i].minDeltaVideoFrameIter);
+            outputDataString += outputDataCString;
+        }
+    }
+    
+    memset(outputDataCString, 0, outputDataCStringSize);
+    sprintf(outputDataCString, "Audiblizer playback mode:%s\n", audiblizer->GetPlaybackMode() == Audiblizer::PlaybackMode_Callback ? "AL_SOFT_callback_buffer" : "queued buffers");
+    outputDataString += outputDataCString;
+    
+    sprintf(outputDataCString, "Audiblizer buffer reclamation:%s\n", audiblizer->EventDriven() ? "AL_SOFT_events" : "polling");
+    outputDataString += outputDataCString;
+    
+    Audiblizer::AudioTimestamp audioTimestamp = audiblizer->PlaybackPosition();
+    memset(outputDataCString, 0, outputDataCStringSize);
+    sprintf(outputDataCString, "Audiblizer PlaybackPosition samples:%llu sec:%f latency compensated:%s\n", audioTimestamp.samples, audioTimestamp.nanoseconds / 1000000000.0, audioTimestamp.latencyCompensated ? "yes" : "no");
+    outputDataString += outputDataCString;
+    
+    Audiblizer::BufferPoolStatistics bufferPoolStatistics = audiblizer->GetBufferPoolStatistics();
+    memset(outputDataCString, 0, outputDataCStringSize);
+    sprintf(outputDataCString, "Audiblizer BufferPool hits:%llu misses:%llu high-water mark:%u pool size:%u\n", bufferPoolStatistics.hits, bufferPoolStatistics.misses, bufferPoolStatistics.highWaterMark, bufferPoolStatistics.poolSize);
+    outputDataString += outputDataCString;
+    
+    Audiblizer::LockStatistics lockStatistics = audiblizer->GetLockStatistics();
+    memset(outputDataCString, 0, outputDataCStringSize);
+    sprintf(outputDataCString, "Audiblizer mutex holds:%llu avg usec:%f max usec:%f - completion dispatches (outside mutex):%llu avg usec:%f max usec:%f\n",
+            lockStatistics.acquisitions,
+            lockStatistics.acquisitions != 0 ? (lockStatistics.totalHoldNanoseconds / (double)lockStatistics.acquisitions) / 1000.0 : 0.0,
+            lockStatistics.maxHoldNanoseconds / 1000.0,
+            lockStatistics.dispatches,
+            lockStatistics.dispatches != 0 ? (lockStatistics.totalDispatchNanoseconds / (double)lockStatistics.dispatches) / 1000.0 : 0.0,
+            lockStatistics.maxDispatchNanoseconds / 1000.0);
+    outputDataString += outputDataCString;
+    
+    if(!virtualClock)
+    {
+        HighPrecisionTimer::TimerStatistics timerStatistics = highPrecisionTimer->GetStatistics();
+        double runNanoseconds = timerStatistics.runNanoseconds != 0 ? (double)timerStatistics.runNanoseconds : 1.0;
+        memset(outputDataCString, 0, outputDataCStringSize);
+        sprintf(outputDataCString, "HighPrecisionTimer fires:%llu lateness avg usec:%f max usec:%f - asleep:%f%% spinning:%f%% (a timer that only spins sleeps 0%%) wake margin usec:%f\n",
+                timerStatistics.fires,
+                timerStatistics.fires != 0 ? (timerStatistics.totalLatenessNanoseconds / (double)timerStatistics.fires) / 1000.0 : 0.0,
+                timerStatistics.maxLatenessNanoseconds / 1000.0,
+                (timerStatistics.sleepNanoseconds / runNanoseconds) * 100.0,
+                (timerStatistics.spinNanoseconds / runNanoseconds) * 100.0,
+                timerStatistics.wakeMarginNanoseconds / 1000.0);
+        outputDataString += outputDataCString;
+        
+        HighPrecisionTimer::ThreadPolicyResult threadPolicyResult = highPrecisionTimer->GetThreadPolicyResult();
+        memset(outputDataCString, 0, outputDataCStringSize);
+        sprintf(outputDataCString, "HighPrecisionTimer thread scheduling:%s priority:%d cpu:%d memory locked:%s\n",
+                threadPolicyResult.realtime ? (threadPolicyResult.roundRobin ? "realtime round-robin" : "realtime FIFO") : "time-sharing (NOT realtime)",
+                threadPolicyResult.priority,
+                threadPolicyResult.cpu,
+                threadPolicyResult.memoryLocked ? "yes" : "no");
+        outputDataString += outputDataCString;
+        
+        // each delegate's own lateness, which (under DispatchMode_Threaded) includes waking its dispatch thread
+        std::shared_ptr<HighPrecisionTimer::Delegate> timerDelegates[] = { videoTimerDelegate, audiblizer };
+        for(size_t i = 0; i < sizeof(timerDelegates) / sizeof(timerDelegates[0]); i++)
+        {
+            HighPrecisionTimer::DelegateStatistics delegateStatistics = highPrecisionTimer->GetDelegateStatistics(timerDelegates[i]);
+            memset(outputDataCString, 0, outputDataCStringSize);
+            sprintf(outputDataCString, "HighPrecisionTimer %s delegate pings:%llu lateness avg usec:%f p50:%f p99:%f p99.9:%f max:%f jitter p99 usec:%f dropped pings:%llu\n",
+                    timerDelegates[i]->TimerDelegateName(),
+                    delegateStatistics.pings,
+                    delegateStatistics.pings != 0 ? (delegateStatistics.totalLatenessNanoseconds / (double)delegateStatistics.pings) / 1000.0 : 0.0,
+                    delegateStatistics.lateness.p50Nanoseconds / 1000.0,
+                    delegateStatistics.lateness.p99Nanoseconds / 1000.0,
+                    delegateStatistics.lateness.p999Nanoseconds / 1000.0,
+                    delegateStatistics.maxLatenessNanoseconds / 1000.0,
+                    delegateStatistics.jitter.p99Nanoseconds / 1000.0,
+                    delegateStatistics.droppedPings);
             outputDataString += outputDataCString;
         }
     }
     
-    if(audiblizerTestHarness->videoFrameHiccup)
+    if(AllocationTracker::Enabled())
+    {
+        uint64_t steadyStateAllocations = steadyStateAllocationBaselineTaken ? AllocationTracker::Count() - steadyStateAllocationBaseline : 0;
+        
+        memset(outputDataCString, 0, outputDataCStringSize);
+        if(steadyStateAllocations != 0)
+        {
+            sprintf(outputDataCString, "*** ALLOCATIONS OCCURRED ON THE AUDIBLIZER TIMER PATH DURING STEADY-STATE PLAYBACK!!! NUM ALLOCATIONS: %llu ***\n", steadyStateAllocations);
+        }
+        else
+        {
+            sprintf(outputDataCString, "Audiblizer steady-state allocations on the timer path:%llu%s\n", steadyStateAllocations, steadyStateAllocationBaselineTaken ? "" : " (steady state never reached)");
+        }
+        outputDataString += outputDataCString;
+    }
+    
+    // a dropped record is a frame missing from the output above (and so possibly a false hiccup), not from playback
+    if(outputDataDropped != 0)
+    {
+        memset(outputDataCString, 0, outputDataCStringSize);
+        sprintf(outputDataCString, "*** OUTPUT DATA RECORDS DROPPED (DATA OUTPUT THREAD FELL BEHIND)!!! NUM RECORDS: %llu ***\n", (unsigned long long)outputDataDropped.load());
+        outputDataString += outputDataCString;
+    }
+    
+    if(videoFrameHiccup)
     {
         memset(outputDataCString, 0, outputDataCStringSize);
-        sprintf(outputDataCString, "*** VIDEO FRAME HICCUPS OCCURRED!!! MAX HICCUP: %d VIDEO FRAMES ***", audiblizerTestHarness->maxVideoFrameHiccup);
+        sprintf(outputDataCString, "*** VIDEO FRAME HICCUPS OCCURRED!!! MAX HICCUP: %d VIDEO FRAMES ***", maxVideoFrameHiccup);
         outputDataString += outputDataCString;
     }
     else
@@ -941,10 +1455,10 @@ void AudiblizerTestHarness::AudioQueueingThreadProc(AudiblizerTestHarness *audib
         outputDataString += outputDataCString;
     }
     
-    if(audiblizerTestHarness->avDrift)
+    if(avDrift)
     {
         memset(outputDataCString, 0, outputDataCStringSize);
-        sprintf(outputDataCString, "*** AUDIO/VIDEO DRIFT OCCURRED!!! MAX DRIFT: %d VIDEO FRAMES - NUM FRAMES WITH DRIFT: %d - %% FRAMES WITH DRIFT: %f%% ***\n", audiblizerTestHarness->maxAVDrift, audiblizerTestHarness->avDriftNumFrames, (audiblizerTestHarness->avDriftNumFrames / (double) audiblizerTestHarness->videoSegmentsTotalNumFrames) * 100.0);
+        sprintf(outputDataCString, "*** AUDIO/VIDEO DRIFT OCCURRED!!! MAX DRIFT: %d VIDEO FRAMES - NUM FRAMES WITH DRIFT: %d - %% FRAMES WITH DRIFT: %f%% ***\n", maxAVDrift, avDriftNumFrames, (avDriftNumFrames / (double) videoSegmentsTotalNumFrames) * 100.0);
         outputDataString += outputDataCString;
     }
     else
@@ -954,94 +1468,121 @@ void AudiblizerTestHarness::AudioQueueingThreadProc(AudiblizerTestHarness *audib
         outputDataString += outputDataCString;
     }
     
-    std::lock_guard<std::mutex> dataOutputterLock(audiblizerTestHarness->dataOutputterMutex);
-    if(audiblizerTestHarness->dataOutputter != nullptr)
+    if(virtualClock)
     {
-        audiblizerTestHarness->dataOutputter->OutputData(outputDataString.c_str());
+        memset(outputDataCString, 0, outputDataCStringSize);
+        sprintf(outputDataCString, "Loopback rendered %f sec of audio in %f sec - PCM checksum:%016llx\n", loopbackFramesRendered / (double)audiblizer->LoopbackSampleRate(), loopbackWallClockSeconds, loopbackChecksum);
+        outputDataString += outputDataCString;
+    }
+    
+    std::lock_guard<std::mutex> dataOutputterLock(dataOutputterMutex);
+    if(dataOutputter != nullptr)
+    {
+        dataOutputter->OutputData(outputDataString.c_str());
     }
     else
     {
         printf("%s", outputDataString.c_str());
     }
-    
-    // tell topside that thread completed
-    // ------------------------------------------------------------
-    audiblizerTestHarness->audioQueueingThreadTerminated.Signal();
 }
 
 void AudiblizerTestHarness::DataOutputThreadProc(AudiblizerTestHarness *audiblizerTestHarness)
 {
-    bool queueIsEmpty = true;
+    const uint32_t outputDataCStringSize = 512;
+    char outputDataCString [outputDataCStringSize];
+    std::string outputDataString;
     bool vfHiccup = false;
     
-    while(audiblizerTestHarness->dataOutputThreadRunning || !queueIsEmpty)
+    while(true)
     {
-        OutputData outputData;
-        std::string outputDataString;
-        const uint32_t outputDataCStringSize = 512;
-        char outputDataCString [outputDataCStringSize];
-        queueIsEmpty = true;
-        vfHiccup = false;
+        OutputData *outputData = nullptr;
+        uint32_t batchSize = 0;
+        outputDataString.clear();
+        audiblizerTestHarness->traceBatch.clear();
         
-        audiblizerTestHarness->outputDataQueueMutex.lock();
-        if(!audiblizerTestHarness->outputDataQueue.empty())
-        {
-            outputData = audiblizerTestHarness->outputDataQueue.front();
-            audiblizerTestHarness->outputDataQueue.pop();
-            queueIsEmpty = false;
-        }
-        audiblizerTestHarness->outputDataQueueMutex.unlock();
+        // NOTE: read the running flag ***before*** checking the ring, as then finding the ring empty after
+        //       the flag has dropped means that it has been fully drained (a loopback test can push its
+        //       entire output and stop well within a single wait below)
+        bool dataOutputThreadRunning = audiblizerTestHarness->dataOutputThreadRunning;
         
-        if(!queueIsEmpty && outputData.videoFrameIter <= audiblizerTestHarness->videoSegmentsTotalNumFrames)
+        // format (or trace) a whole batch of records, and only then output all of them in one go
+        while(batchSize < DataOutputMaxBatchSize && (outputData = audiblizerTestHarness->outputDataRing.Front()) != nullptr)
         {
+            batchSize++;
+            vfHiccup = false;
+            
+            if(outputData->videoFrameIter > audiblizerTestHarness->videoSegmentsTotalNumFrames)
+            {
+                audiblizerTestHarness->outputDataRing.PopFront();
+                continue;
+            }
+            
             bool drift = false;
             
             // handle info regarding last VFI
             // ---------------------------------------------------------------
             if(audiblizerTestHarness->lastVideoFrameIter != 0)
             {
-                if(audiblizerTestHarness->lastVideoFrameIter + 1 != outputData.videoFrameIter)
+                if(audiblizerTestHarness->lastVideoFrameIter + 1 != outputData->videoFrameIter)
                 {
                     audiblizerTestHarness->videoFrameHiccup = vfHiccup = true;
-                    if(outputData.videoFrameIter - audiblizerTestHarness->lastVideoFrameIter > audiblizerTestHarness->maxVideoFrameHiccup)
+                    if(outputData->videoFrameIter - audiblizerTestHarness->lastVideoFrameIter > audiblizerTestHarness->maxVideoFrameHiccup)
                     {
-                        audiblizerTestHarness->maxVideoFrameHiccup = (uint32_t) (outputData.videoFrameIter - audiblizerTestHarness->lastVideoFrameIter);
+                        audiblizerTestHarness->maxVideoFrameHiccup = (uint32_t) (outputData->videoFrameIter - audiblizerTestHarness->lastVideoFrameIter);
                     }
                 }
             }
             
-            audiblizerTestHarness->lastVideoFrameIter = outputData.videoFrameIter;
-        
+            audiblizerTestHarness->lastVideoFrameIter = outputData->videoFrameIter;
+            
             // see if there was any av drift
             // NOTE: to keep things clean and sane, we add 'adversarialTestingAudioChunkCacheAccum'
             //       to the mix, so that when testing w/ cached audio pumps we do not erroneously
             //       report drift
             // ---------------------------------------------------------------
-            if(abs((outputData.audioChunkIter + outputData.adversarialTestingAudioChunkCacheAccum) - outputData.videoFrameIter) > 1)
+            if(abs((outputData->audioChunkIter + outputData->adversarialTestingAudioChunkCacheAccum) - outputData->videoFrameIter) > 1)
             {
                 audiblizerTestHarness->avDrift = true;
                 audiblizerTestHarness->avDriftNumFrames++;
                 
-                if(abs(outputData.audioChunkIter - outputData.videoFrameIter) > audiblizerTestHarness->maxAVDrift)
+                if(abs(outputData->audioChunkIter - outputData->videoFrameIter) > audiblizerTestHarness->maxAVDrift)
                 {
-                    audiblizerTestHarness->maxAVDrift = (uint32_t) abs(outputData.audioChunkIter - outputData.videoFrameIter);
+                    audiblizerTestHarness->maxAVDrift = (uint32_t) abs(outputData->audioChunkIter - outputData->videoFrameIter);
                 }
                 
                 drift = true;
             }
             
-            if(audiblizerTestHarness->adversarialTestingAudioChunkCacheSize == 1)
+            if(audiblizerTestHarness->traceFile != nullptr)
+            {
+                TraceFormat::TraceRecord traceRecord;
+                
+                traceRecord.avEqualizer = outputData->avEqualizer;
+                traceRecord.audioChunkIter = outputData->audioChunkIter;
+                traceRecord.videoFrameIter = outputData->videoFrameIter;
+                traceRecord.audioPositionSeconds = outputData->audioPositionSeconds;
+                traceRecord.deltaSeconds = outputData->deltaFloatingPointSeconds.count();
+                traceRecord.totalSeconds = outputData->totalFloatingPointSeconds.count();
+                traceRecord.adversarialTestingAudioChunkCacheAccum = outputData->adversarialTestingAudioChunkCacheAccum;
+                traceRecord.flags = (outputData->pumpVideoFrameSender == PumpVideoFrameSender_AudioUnqueuer ? TraceFormat::RecordFlag_SenderAudioUnqueuer : 0) |
+                                    (vfHiccup ? TraceFormat::RecordFlag_VideoFrameHiccup : 0) |
+                                    (drift ? TraceFormat::RecordFlag_AVDrift : 0);
+                
+                audiblizerTestHarness->traceBatch.push_back(traceRecord);
+            }
+            else if(audiblizerTestHarness->adversarialTestingAudioChunkCacheSize == 1)
             {
                 memset(outputDataCString, 0, outputDataCStringSize);
                 sprintf(outputDataCString,
-                        "Sender:%s   A/V Eq:%04lld   ACI:%06lld   VFI:%06lld%s  delta sec:%f   total sec:%f",
-                        outputData.pumpVideoFrameSender == PumpVideoFrameSender_VideoTimer ? "V" : "A",
-                        outputData.avEqualizer,
-                        outputData.audioChunkIter,
-                        outputData.videoFrameIter,
+                        "Sender:%s   A/V Eq:%04lld   ACI:%06lld   VFI:%06lld%s  delta sec:%f   total sec:%f   audio sec:%f",
+                        outputData->pumpVideoFrameSender == PumpVideoFrameSender_VideoTimer ? "V" : "A",
+                        outputData->avEqualizer,
+                        outputData->audioChunkIter,
+                        outputData->videoFrameIter,
                         vfHiccup ? "*" : " ",
-                        outputData.deltaFloatingPointSeconds.count(),
-                        outputData.totalFloatingPointSeconds.count());
+                        outputData->deltaFloatingPointSeconds.count(),
+                        outputData->totalFloatingPointSeconds.count(),
+                        outputData->audioPositionSeconds);
                 
                 outputDataString += outputDataCString;
             }
@@ -1049,28 +1590,42 @@ void AudiblizerTestHarness::DataOutputThreadProc(AudiblizerTestHarness *audibliz
             {
                 memset(outputDataCString, 0, outputDataCStringSize);
                 sprintf(outputDataCString,
-                        "Sender:%s   A/V Eq:%04lld   ACI:%06lld+%02d   VFI:%06lld%s  delta sec:%f   total sec:%f",
-                        outputData.pumpVideoFrameSender == PumpVideoFrameSender_VideoTimer ? "V" : "A",
-                        outputData.avEqualizer,
-                        outputData.audioChunkIter,
-                        outputData.adversarialTestingAudioChunkCacheAccum,
-                        outputData.videoFrameIter,
+                        "Sender:%s   A/V Eq:%04lld   ACI:%06lld+%02d   VFI:%06lld%s  delta sec:%f   total sec:%f   audio sec:%f",
+                        outputData->pumpVideoFrameSender == PumpVideoFrameSender_VideoTimer ? "V" : "A",
+                        outputData->avEqualizer,
+                        outputData->audioChunkIter,
+                        outputData->adversarialTestingAudioChunkCacheAccum,
+                        outputData->videoFrameIter,
                         vfHiccup ? "*" : " ",
-                        outputData.deltaFloatingPointSeconds.count(),
-                        outputData.totalFloatingPointSeconds.count());
+                        outputData->deltaFloatingPointSeconds.count(),
+                        outputData->totalFloatingPointSeconds.count(),
+                        outputData->audioPositionSeconds);
                 
                 outputDataString += outputDataCString;
             }
             
-            if(drift)
+            if(audiblizerTestHarness->traceFile == nullptr)
+            {
+                outputDataString += drift ? "   *** DRIFT ***\n" : "\n";
+            }
+            
+            audiblizerTestHarness->outputDataRing.PopFront();
+        }
+        
+        if(!audiblizerTestHarness->traceBatch.empty() && !audiblizerTestHarness->traceWriteFailed)
+        {
+            if(fwrite(audiblizerTestHarness->traceBatch.data(), sizeof(TraceFormat::TraceRecord), audiblizerTestHarness->traceBatch.size(), audiblizerTestHarness->traceFile) == audiblizerTestHarness->traceBatch.size())
             {
-                outputDataString += "   *** DRIFT ***\n";
+                audiblizerTestHarness->traceRecordsWritten += audiblizerTestHarness->traceBatch.size();
             }
             else
             {
-                outputDataString += "\n";
+                audiblizerTestHarness->traceWriteFailed = true;
             }
-            
+        }
+        
+        if(!outputDataString.empty())
+        {
             std::lock_guard<std::mutex> lock(audiblizerTestHarness->dataOutputterMutex);
             if(audiblizerTestHarness->dataOutputter != nullptr)
             {
@@ -1081,9 +1636,25 @@ void AudiblizerTestHarness::DataOutputThreadProc(AudiblizerTestHarness *audibliz
                 printf("%s", outputDataString.c_str());
             }
         }
-        else
+        
+        if(batchSize == 0)
         {
-            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            if(!dataOutputThreadRunning)
+            {
+                break;
+            }
+            
+            // sleep until PumpVideoFrame() pushes another record (or StopTest() drops the running flag)
+            // NOTE: the timeout is only a safety net
+            audiblizerTestHarness->outputDataWake.PrepareWait();
+            if(audiblizerTestHarness->outputDataRing.Empty() && audiblizerTestHarness->dataOutputThreadRunning)
+            {
+                audiblizerTestHarness->outputDataWake.Wait(std::chrono::milliseconds(100));
+            }
+            else
+            {
+                audiblizerTestHarness->outputDataWake.CancelWait();
+            }
         }
         
     }
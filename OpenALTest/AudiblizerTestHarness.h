@@ -29,9 +29,15 @@
 #include "Audiblizer.h"
 #include "VideoTimerDelegate.h"
 #include "Event.h"
+#include "WakeSignal.h"
+#include "RingBuffer.h"
+#include "TraceFormat.h"
 
 #include <vector>
-#include <queue>
+#include <map>
+#include <atomic>
+#include <string>
+#include <cstdio>
 #include <thread>
 #include <memory>
 #include <chrono>
@@ -45,7 +51,7 @@ public:
     
     std::shared_ptr<AudiblizerTestHarness> getptr() { return shared_from_this(); }
     
-    virtual bool Initialize();
+    virtual bool Initialize(const Audiblizer::Configuration &audiblizerConfiguration = Audiblizer::Configuration());
     virtual bool LoadAudio(const char *filePath, uint32_t sampleRate);
     virtual bool GenerateSampleAudio(uint32_t sampleRate, bool stereo, bool silence, double durationSeconds);
     virtual void PrepareForDestruction();
@@ -64,6 +70,10 @@ public:
     virtual bool StopTest();
     virtual void WaitOnTestCompletion();
     
+    // only ever true when built w/ AUDIBLIZER_TRACK_ALLOCATIONS=1, in which case the Audiblizer's
+    // timer-thread work is required to be allocation free once playback has reached steady state
+    virtual bool SteadyStateAllocationsOccurred() { return steadyStateAllocationBaselineTaken && AllocationTracker::Count() != steadyStateAllocationBaseline; }
+    
     // Audiblizer::AudioChunkCompletionListener interface
     // ------------------------------------------------------------------
     virtual void AudioChunkCompleted(const AudioChunkCompletedVector &buffersCompleted);
@@ -95,6 +105,48 @@ public:
     
     virtual void SetDataOutputter(std::shared_ptr<DataOutputter> outputter) { std::lock_guard<std::mutex> lock(dataOutputterMutex); dataOutputter = outputter; }
     
+    // how many per-frame records the current (or last) test could not hand to the data output thread
+    // because it had fallen a full ring behind. Such frames are missing from the output, but NOT from playback
+    virtual uint64_t OutputDataDropped() { return outputDataDropped.load(); }
+    
+    // Binary Trace
+    // NOTE: when set (before StartTest()), the per-frame timing data is written to 'filePath' as a binary
+    //       trace of fixed-size records (see TraceFormat.h) rather than formatted as text, which is left to
+    //       Tools/TraceFormatter, off the machine under test. The end of test summary is output as ever.
+    //       An empty path goes back to text. Returns false while a test is running
+    // ------------------------------------------------------------------
+    virtual bool SetTraceFile(const char *filePath);
+    
+    // Loopback Capture
+    // NOTE: only applies when the Audiblizer was initialized w/ a loopback device, in which case
+    //       the test is driven by a virtual clock that advances as audio is rendered, rather
+    //       than by the HighPrecisionTimer. The rendered PCM is interleaved 16-bit stereo
+    // ------------------------------------------------------------------
+    virtual void SetLoopbackCapture(bool capture) { std::lock_guard<std::mutex> lock(loopbackCaptureMutex); loopbackCapture = capture; }
+    virtual std::vector<int16_t> LoopbackCapturedAudio() { std::lock_guard<std::mutex> lock(loopbackCaptureMutex); return loopbackCapturedAudio; }
+    
+    // Clock
+    // NOTE: must be set before Initialize(). A virtual clock (e.g. VirtualClock) is for loopback devices
+    //       only, and vice versa. When none is set, the harness picks whichever of the two fits
+    // ------------------------------------------------------------------
+    virtual bool SetClock(std::shared_ptr<Clock> testClock);
+    virtual std::shared_ptr<Clock> GetClock() { return clock; }
+    
+    // Timer Thread Policy / Dispatch Mode
+    // NOTE: must be set after Initialize() and before StartTest(). Returns false if the
+    //       harness is not yet initialized, or if the test is already running
+    // ------------------------------------------------------------------
+    virtual bool SetTimerThreadPolicy(const HighPrecisionTimer::ThreadPolicy &policy);
+    virtual bool SetTimerDispatchMode(HighPrecisionTimer::DispatchMode mode);
+    
+    // Audio Queue Depth
+    // NOTE: how much audio the queueing thread keeps queued (4 sec by default). The thread sleeps until
+    //       completions drain the queue below its low watermark (a quarter of the depth, or 250 ms, whichever
+    //       is less), so the depth only has to cover the latency of a completion rather than of a poll, and
+    //       as little as 50 - 100 ms will do. Returns false while a test is running
+    // ------------------------------------------------------------------
+    virtual bool SetAudioQueueDepth(double seconds);
+    
 protected:
     bool initialized;
     
@@ -115,12 +167,24 @@ protected:
     static void FreeAudioSample(void* data);
     
 private:
-    typedef uint64_t VideoPlaymapKey;
-    typedef VideoParameters VideoPlaymapValue;
-    typedef std::map<VideoPlaymapKey, VideoPlaymapValue> VideoPlaymap;
-    typedef std::pair<VideoPlaymapKey, VideoPlaymapValue> VideoPlaymapPair;
-    typedef VideoPlaymap::iterator VideoPlaymapIterator;
-    typedef std::pair<VideoPlaymapIterator, bool> VideoPlaymapInsertionPair;
+    // the first video frame of every segment, in order, plus a sentinel (past any frame) at the end. Frames are
+    // pumped in order, so finding a frame's segment is almost always a look at the current segment, or at the
+    // next, from 'videoSegmentCursor'. Anything further off (e.g. a seek) falls back to a binary search. Holds up
+    // just as well for variable frame rate content, described as a segment per frame
+    class VideoSegmentBoundary
+    {
+    public:
+        VideoSegmentBoundary() : firstFrame(0), sampleDuration(0), timeScale(0) {}
+        VideoSegmentBoundary(uint64_t first, uint32_t sd, uint32_t ts) : firstFrame(first), sampleDuration(sd), timeScale(ts) {}
+        
+        bool operator<(const VideoSegmentBoundary &rhs) const { return firstFrame < rhs.firstFrame; }
+        
+        uint64_t firstFrame;
+        uint32_t sampleDuration;
+        uint32_t timeScale;
+    };
+    
+    typedef std::vector<VideoSegmentBoundary> VideoSegmentIndex;
     
     std::shared_ptr<Audiblizer> audiblizer;
     std::shared_ptr<VideoTimerDelegate> videoTimerDelegate;
@@ -128,12 +192,16 @@ private:
     
     VideoSegments videoSegments;
     uint32_t      videoSegmentsTotalNumFrames;
-    VideoPlaymap  videoPlaymap;
+    VideoSegmentIndex videoSegmentIndex;
+    size_t        videoSegmentCursor;
     uint64_t      frameRateAdjustedOnFrameIndex;
     double    audioPlayrateFactor; // the actual factor of 'ideal audio playrate / actual audio playrate'
-    const double maxQueuedAudioDurationSeconds;
+    double    maxQueuedAudioDurationSeconds;  // see SetAudioQueueDepth()
+    double    queuedAudioLowWatermarkSeconds; // the queueing thread tops the queue back off once it drains below this
     static const Audiblizer::AudioFormat audioFormat;
     
+    size_t VideoSegmentForFrame(uint64_t frame); // the index into 'videoSegmentIndex'
+    
     std::mutex videoPumpMutex;
     uint64_t audioChunkIter;
     uint64_t videoFrameIter;
@@ -143,8 +211,17 @@ private:
     uint64_t audioRunningSlowAccum;
     const uint64_t audioRunningSlowThreshold = 3;
     
-    std::chrono::high_resolution_clock::time_point lastCallToPumpVideoFrame;
-    std::chrono::high_resolution_clock::time_point playbackStart;
+    // --- Clock ---
+    // what everything in the test (the timer and its delegates included) reads the time from. When
+    // rendering via a loopback device this is a virtual clock, which the loopback render thread sets to
+    // the duration of the audio rendered thus far, and which thus runs as fast as audio can be rendered
+    std::shared_ptr<Clock>        clock;
+    std::shared_ptr<VirtualClock> virtualClock; // 'clock', if virtual, nullptr otherwise
+    
+    Clock::TimePoint Now() { return clock->Now(); }
+    
+    Clock::TimePoint lastCallToPumpVideoFrame;
+    Clock::TimePoint playbackStart;
     bool firstCallToPumpVideoFrame;
     
     class VideoSegmentOutputData
@@ -181,15 +258,61 @@ private:
     
     std::chrono::duration<double> audioPlaybackDurationActual;
     double                        audioPlaybackDurationIdeal;
-    std::chrono::high_resolution_clock::time_point lastCallToAudioChunkCompleted;
+    Clock::TimePoint lastCallToAudioChunkCompleted;
     bool                                           firstCallToAudioChunkCompleted;
     
+    // allocation count at the point that every in-flight chunk has cycled through the Audiblizer at least once
+    uint64_t                      steadyStateAllocationBaseline;
+    bool                          steadyStateAllocationBaselineTaken;
+    
     // --- Audio Queueing Thread ---
     std::thread *audioQueueingThread;
     bool         audioQueueingThreadRunning;
     Event        audioQueueingThreadTerminated;
+    Event        audioQueueingThreadWake;       // signaled by completions that leave the queue below its low watermark, and by StopTest()
+    
+    // --- Audio Chunk Schedule ---
+    // the audio for every video frame of the test, worked out once by StartTest(). Frame N starts at exactly
+    // floor(N's start time * sample rate), where the start time is summed over the segments in integer
+    // rational arithmetic, so however long the test, the audio queued never drifts from the video by
+    // more than a single sample. The producer merely walks the table
+    class AudioChunkScheduleEntry
+    {
+    public:
+        AudioChunkScheduleEntry() : startSample(0), numSamples(0) {}
+        AudioChunkScheduleEntry(uint64_t start, uint32_t num) : startSample(start), numSamples(num) {}
+        
+        uint64_t startSample; // of the test as a whole
+        uint32_t numSamples;
+    };
+    
+    typedef std::vector<AudioChunkScheduleEntry> AudioChunkSchedule;
+    
+    AudioChunkSchedule audioChunkSchedule;
+    size_t             audioChunkScheduleIter; // the next entry to be queued
+    
+    static bool BuildAudioChunkSchedule(const VideoSegments &segments, uint32_t sampleRate, double playrateFactor, AudioChunkSchedule &schedule);
+    static bool CheckedMultiply(uint64_t a, uint64_t b, uint64_t &product); // false on overflow
+    static bool FrameStep(uint64_t sampleDuration, uint64_t sampleRate, uint64_t factorNumerator, uint64_t denominatorScale, uint64_t &step);
     
     static void  AudioQueueingThreadProc(AudiblizerTestHarness *audiblizerTestHarness);
+    bool         AllAudioQueued() { return audioChunkScheduleIter >= audioChunkSchedule.size(); }
+    bool         QueueAudioChunks(double maxDurationToBeQueued); // false if nothing was queued
+    void         OutputEndOfTestData();
+    void         StopTestThreads();
+    
+    // --- Loopback Render Thread ---
+    // NOTE: runs in place of the Audio Queueing Thread (and of the HighPrecisionTimer) when
+    //       the Audiblizer is using a loopback device, so that a test runs as fast as OpenAL
+    //       can render and is repeatable from run to run
+    std::vector<int16_t> loopbackCapturedAudio;
+    bool                 loopbackCapture;
+    std::mutex           loopbackCaptureMutex;
+    uint64_t             loopbackFramesRendered;
+    uint64_t             loopbackChecksum; // FNV-1a over all of the rendered PCM
+    double               loopbackWallClockSeconds;
+    
+    static void  LoopbackRenderThreadProc(AudiblizerTestHarness *audiblizerTestHarness);
     
     // --- Data Output Thread ---
     class OutputData
@@ -200,8 +323,9 @@ private:
         int64_t audioChunkIter;
         uint32_t adversarialTestingAudioChunkCacheAccum;
         int64_t videoFrameIter;
-        std::chrono::duration<float> deltaFloatingPointSeconds;
-        std::chrono::duration<float> totalFloatingPointSeconds;
+        std::chrono::duration<double> deltaFloatingPointSeconds;
+        std::chrono::duration<double> totalFloatingPointSeconds;
+        double audioPositionSeconds; // Audiblizer::PlaybackPosition() at the time of the pump
     };
     
     std::mutex dataOutputterMutex;
@@ -226,13 +350,25 @@ private:
         static void AdversarialPressureThreadProc(AdversarialPressureThread *adversarialPressureThread);
     };
     
-    typedef std::queue<OutputData> OutputDataQueue;
-    
-    OutputDataQueue outputDataQueue;
-    std::mutex outputDataQueueMutex;
-    
-    std::thread *dataOutputThread;
-    bool         dataOutputThreadRunning;
+    // PumpVideoFrame() runs on the timer (or audio completion) thread, so handing its records off must
+    // never lock or allocate: 'outputDataRing' is sized by StartTest() (a record per frame, up to 64K), Push()
+    // is wait-free, and a record that does not fit is counted in 'outputDataDropped' rather than waited
+    // on. NOTE: every producer holds 'mutex', which keeps the ring single-producer
+    LockFreeRingBuffer<OutputData> outputDataRing;
+    std::atomic<uint64_t>          outputDataDropped;
+    WakeSignal                     outputDataWake;
+    
+    // --- Binary Trace ---
+    std::string                            traceFilePath;
+    FILE                                  *traceFile;  // open from StartTest() to StopTest() when tracing
+    std::vector<TraceFormat::TraceRecord>  traceBatch; // only touched by the data output thread
+    uint64_t                               traceRecordsWritten;
+    bool                                   traceWriteFailed;
+    
+    std::thread       *dataOutputThread;
+    std::atomic<bool>  dataOutputThreadRunning;
+    
+    static const uint32_t DataOutputMaxBatchSize = 64; // records formatted (or traced) per output
     
     static void DataOutputThreadProc(AudiblizerTestHarness *audiblizerTestHarness);
     
@@ -0,0 +1,84 @@
+// ****************************************************************************
+// MIT License
+//
+// Copyright (c) 2019 Joshua E Bodinet
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// ****************************************************************************
+
+#ifndef Clock_h
+#define Clock_h
+
+#include <chrono>
+#include <memory>
+#include <atomic>
+#include <cstdint>
+
+// Where HighPrecisionTimer, its delegates and the test harness get the time from. SteadyClock is the
+// real (monotonic) clock. VirtualClock only ever moves when it is told to, such that a test that is
+// driven by one runs as fast as the CPU allows, and gives the same results every time
+class Clock
+{
+public:
+    typedef std::chrono::steady_clock::time_point TimePoint;
+    typedef std::chrono::steady_clock::duration   Duration;
+    
+    Clock() {}
+    virtual ~Clock() {}
+    
+    virtual TimePoint Now() = 0;
+    virtual bool Virtual() { return false; } // true if Now() only moves when told to (i.e. nobody can wait on it in real time)
+    
+    static std::shared_ptr<Clock> Steady(); // the one SteadyClock that everything shares by default
+};
+
+class SteadyClock : public Clock
+{
+public:
+    SteadyClock() {}
+    virtual ~SteadyClock() {}
+    
+    virtual TimePoint Now() { return std::chrono::steady_clock::now(); }
+};
+
+class VirtualClock : public Clock
+{
+public:
+    VirtualClock() : nanoseconds(0) {}
+    virtual ~VirtualClock() {}
+    
+    virtual TimePoint Now() { return TimePoint(std::chrono::duration_cast<Duration>(std::chrono::nanoseconds(nanoseconds.load()))); }
+    virtual bool Virtual() { return true; }
+    
+    // NOTE: starts out at TimePoint(), and should never be set back while anything is keeping time by it
+    void Set(const TimePoint &timePoint) { nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(timePoint.time_since_epoch()).count(); }
+    void Advance(const std::chrono::nanoseconds &duration) { nanoseconds += duration.count(); }
+    
+private:
+    std::atomic<int64_t> nanoseconds;
+};
+
+inline std::shared_ptr<Clock> Clock::Steady()
+{
+    static std::shared_ptr<Clock> steadyClock = std::make_shared<SteadyClock>();
+    
+    return steadyClock;
+}
+
+#endif /* Clock_h */
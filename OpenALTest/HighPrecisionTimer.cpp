@@ -26,8 +26,78 @@
 
 #include <pthread.h>
 #include <sched.h>
+#if defined(__linux__)
+#include <sys/prctl.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#endif
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+void HighPrecisionTimer::Delegate::ScheduleChanged()
+{
+    HighPrecisionTimer *highPrecisionTimer = timer.load();
+    
+    if(highPrecisionTimer != nullptr)
+    {
+        highPrecisionTimer->MarkScheduleDirty();
+    }
+}
+
+Clock::TimePoint HighPrecisionTimer::Delegate::TimerNow()
+{
+    HighPrecisionTimer *highPrecisionTimer = timer.load();
+    
+    return highPrecisionTimer != nullptr ? highPrecisionTimer->clock->Now() : Clock::Steady()->Now();
+}
+
+void HighPrecisionTimer::Delegate::PingStatistics::Reset()
+{
+    pings = 0;
+    totalLatenessNanoseconds = 0;
+    maxLatenessNanoseconds = 0;
+    droppedPings = 0;
+    latenessHistogram.Reset();
+    jitterHistogram.Reset();
+    lastLatenessNanoseconds = -1;
+}
+
+static void AtomicMax(std::atomic<uint64_t> &max, uint64_t value)
+{
+    uint64_t current = max.load(std::memory_order_relaxed);
+    while(value > current && !max.compare_exchange_weak(current, value, std::memory_order_relaxed))
+    {
+        
+    }
+}
 
-HighPrecisionTimer::HighPrecisionTimer() :
+// bounds on the learned wake margin, and what it starts out at
+static const std::chrono::nanoseconds minWakeMargin = std::chrono::microseconds(20);
+static const std::chrono::nanoseconds maxWakeMargin = std::chrono::milliseconds(20);
+static const std::chrono::nanoseconds initialWakeMargin = std::chrono::microseconds(50); // small enough that even short waits sleep, and thus learn
+
+HighPrecisionTimer::HighPrecisionTimer(std::shared_ptr<Clock> timerClock) :
+    publishedSnapshot(nullptr),
+    snapshotInUse(nullptr),
+    snapshotGeneration(0),
+    scheduleBackend(ScheduleBackend_Heap),
+    scheduledSnapshot(nullptr),
+    scheduleDirty(true),
+    clock(timerClock != nullptr ? timerClock : Clock::Steady()),
+    wakeMargin(initialWakeMargin),
+    wakeOvershootAverage(0),
+    wakeOvershootDeviation(initialWakeMargin.count() / 4.0),
+    statisticsFires(0),
+    statisticsTotalLatenessNanoseconds(0),
+    statisticsMaxLatenessNanoseconds(0),
+    statisticsRunNanoseconds(0),
+    statisticsSleepNanoseconds(0),
+    statisticsSpinNanoseconds(0),
+    statisticsWakeMarginNanoseconds(0),
+    dumpStatisticsOnStop(true),
+    dispatchMode(DispatchMode_Inline),
+    dispatchWorkersRunning(false),
     timerThread(nullptr),
     timerThreadRunning(false)
 {
@@ -37,6 +107,13 @@ HighPrecisionTimer::HighPrecisionTimer() :
 HighPrecisionTimer::~HighPrecisionTimer()
 {
     Stop();
+    RemoveAllDelegates();
+    
+    delegateSetMutex.lock();
+    ReapDispatchWorkers(true);
+    ReclaimSnapshots(true);
+    delete publishedSnapshot.exchange(nullptr);
+    delegateSetMutex.unlock();
 }
 
 bool HighPrecisionTimer::Start()
@@ -48,13 +125,54 @@ bool HighPrecisionTimer::Start()
         return false;
     }
     
+    if(clock->Virtual())
+    {
+        printf("ERROR: A HighPrecisionTimer on a virtual clock is to be Step()ped, NOT Start()ed!!!\n");
+        return false;
+    }
+    
     delegateSetMutex.lock();
+    PruneDelegateSet();
     for(DelegateSetIterator iter = delegateSet.begin(); iter != delegateSet.end(); iter++)
     {
-        iter->get()->LastPing(std::chrono::high_resolution_clock::now()); // note the time
+        iter->get()->LastPing(clock->Now()); // note the time
+    }
+    
+    ResetStatistics();
+    delegateSetMutex.unlock();
+    
+    // lock memory before the thread exists, so that its stack is locked as it is mapped
+    // ----------------------------------------------------------------------------------
+    threadPolicyResult = ThreadPolicyResult();
+#if defined(__linux__)
+    if(threadPolicy.lockMemory)
+    {
+        if(mlockall(MCL_CURRENT | MCL_FUTURE) == 0)
+        {
+            threadPolicyResult.memoryLocked = true;
+        }
+        else
+        {
+            printf("Failed to lock memory!!! Error:%s\n", std::strerror(errno));
+        }
+    }
+#endif
+    
+    // give every delegate a thread of its own before the timer starts firing them
+    // ----------------------------------------------------------------------------------
+    delegateSetMutex.lock();
+    dispatchWorkersRunning = (dispatchMode == DispatchMode_Threaded);
+    if(dispatchWorkersRunning)
+    {
+        for(DelegateSetIterator iter = delegateSet.begin(); iter != delegateSet.end(); iter++)
+        {
+            StartDispatchWorker(*iter);
+        }
     }
+    PublishSnapshot();
     delegateSetMutex.unlock();
     
+    scheduleDirty = true;
     timerThreadRunning = true;
     timerThread = new (std::nothrow) std::thread (TimerThreadProc, this);
     if(timerThread == nullptr)
@@ -62,28 +180,187 @@ bool HighPrecisionTimer::Start()
         return false;
     }
     
-    // set the timer thread to use a FIFO policy with top priority
-    // ----------------------------------------------------------------------------------
-#if defined(__APPLE__)
-    sched_param sch_params;
-    int policy = SCHED_FIFO;
-    sch_params.sched_priority = sched_get_priority_max(policy);
-    int pErr = pthread_setschedparam(timerThread->native_handle(), policy, &sch_params);
-    if(pErr != 0)
+    ApplyThreadPolicy(timerThread, threadPolicy, threadPolicyResult);
+    
+    return true;
+}
+
+bool HighPrecisionTimer::SetThreadPolicy(const ThreadPolicy &policy)
+{
+    std::lock_guard<std::mutex> lock(timerMutex);
+    
+    if(timerThread != nullptr)
+    {
+        return false;
+    }
+    
+    threadPolicy = policy;
+    
+    return true;
+}
+
+bool HighPrecisionTimer::SetDispatchMode(DispatchMode mode)
+{
+    std::lock_guard<std::mutex> lock(timerMutex);
+    
+    if(timerThread != nullptr)
+    {
+        return false;
+    }
+    
+    dispatchMode = mode;
+    
+    return true;
+}
+
+bool HighPrecisionTimer::SetScheduleBackend(ScheduleBackend backend)
+{
+    std::lock_guard<std::mutex> lock(timerMutex);
+    
+    if(timerThread != nullptr)
+    {
+        return false;
+    }
+    
+    // NOTE: a timer that is being Step()ped moves everything over to the new backend on its next Step()
+    scheduleBackend = backend;
+    MarkScheduleDirty();
+    
+    return true;
+}
+
+HighPrecisionTimer::ThreadPolicyResult HighPrecisionTimer::GetThreadPolicyResult()
+{
+    std::lock_guard<std::mutex> lock(timerMutex);
+    
+    return threadPolicyResult;
+}
+
+int HighPrecisionTimer::FirstIsolatedCPU()
+{
+    int cpu = -1;
+    
+#if defined(__linux__)
+    // a cpu list, such as "2-3,6" (or an empty line when there are none)
+    FILE *isolated = fopen("/sys/devices/system/cpu/isolated", "r");
+    if(isolated != nullptr)
     {
-        printf("Failed to set Thread scheduling!!! Error:%s\n", std::strerror(errno));
+        if(fscanf(isolated, "%d", &cpu) != 1)
+        {
+            cpu = -1;
+        }
         
+        fclose(isolated);
+    }
+#endif
+    
+    return cpu;
+}
+
+HighPrecisionTimer::ThreadPolicy HighPrecisionTimer::DispatchThreadPolicy()
+{
+    ThreadPolicy policy = threadPolicy;
+    
+    // the timer thread may well be spinning on its cpu, so leave the dispatch threads free to run anywhere
+    policy.cpu = -1;
+    policy.lockMemory = false; // already applies to the whole process
+    
+    // one priority below the timer thread, such that keeping time always comes before pinging
+#if defined(__APPLE__) || defined(__linux__)
+    if(policy.realtime)
+    {
+        int maxPriority = sched_get_priority_max(policy.roundRobin ? SCHED_RR : SCHED_FIFO);
+        policy.priority = (policy.priority < 0 ? maxPriority : std::min(policy.priority, maxPriority)) - 1;
+    }
+#endif
+    
+    return policy;
+}
+
+void HighPrecisionTimer::ApplyThreadPolicy(std::thread *thread, const ThreadPolicy &policy, ThreadPolicyResult &result)
+{
+    // set the thread to use a realtime policy (FIFO unless otherwise asked) with top priority (unless otherwise asked)
+    // ----------------------------------------------------------------------------------
+#if defined(__APPLE__) || defined(__linux__)
+    if(policy.realtime)
+    {
+        sched_param sch_params;
+        int schedPolicy = policy.roundRobin ? SCHED_RR : SCHED_FIFO;
+        int maxPriority = sched_get_priority_max(schedPolicy);
+        sch_params.sched_priority = policy.priority < 0 ? maxPriority : std::min(std::max(policy.priority, sched_get_priority_min(schedPolicy)), maxPriority);
+        int pErr = pthread_setschedparam(thread->native_handle(), schedPolicy, &sch_params);
+#if defined(__linux__)
+        // an unprivileged process may still be allowed realtime priorities up to RLIMIT_RTPRIO
+        rlimit rtprio;
+        if(pErr == EPERM && getrlimit(RLIMIT_RTPRIO, &rtprio) == 0 && rtprio.rlim_cur > 0 && (int)rtprio.rlim_cur < sch_params.sched_priority)
+        {
+            sch_params.sched_priority = (int)rtprio.rlim_cur;
+            pErr = pthread_setschedparam(thread->native_handle(), schedPolicy, &sch_params);
+        }
+#endif
+        if(pErr != 0)
+        {
+            printf("Failed to set Thread scheduling!!! Error:%s\n", std::strerror(pErr));
+        }
+        else
+        {
+            result.realtime = true;
+            result.roundRobin = policy.roundRobin;
+            result.priority = sch_params.sched_priority;
+        }
     }
 #elif defined(_WIN32)
-    int threadPriority = THREAD_PRIORITY_HIGHEST;
-    threadPriority = THREAD_PRIORITY_TIME_CRITICAL;
-    if(!SetThreadPriority(timerThread->native_handle(), threadPriority))
+    if(policy.realtime)
     {
-        printf("Failed to set Thread priority!!!\n");
+        int threadPriority = THREAD_PRIORITY_HIGHEST;
+        threadPriority = THREAD_PRIORITY_TIME_CRITICAL;
+        if(!SetThreadPriority(thread->native_handle(), threadPriority))
+        {
+            printf("Failed to set Thread priority!!!\n");
+        }
+        else
+        {
+            result.realtime = true;
+            result.priority = threadPriority;
+        }
     }
 #endif
     
-    return true;
+    // pin the thread to a single cpu (ideally an isolated one, such that nothing else is ever scheduled there)
+    // ----------------------------------------------------------------------------------
+#if defined(__linux__)
+    if(policy.cpu >= 0)
+    {
+        cpu_set_t cpuSet;
+        CPU_ZERO(&cpuSet);
+        CPU_SET(policy.cpu, &cpuSet);
+        
+        int pErr = pthread_setaffinity_np(thread->native_handle(), sizeof(cpuSet), &cpuSet);
+        if(pErr != 0)
+        {
+            printf("Failed to set Thread affinity!!! Error:%s\n", std::strerror(pErr));
+        }
+        else
+        {
+            result.cpu = policy.cpu;
+        }
+    }
+#endif
+}
+
+void HighPrecisionTimer::PrefaultStack()
+{
+    // touch a good deal more stack than the timer thread (and the delegates that it pings) is ever expected
+    // to use, such that, w/ memory locked, none of it ever has to be faulted in while keeping time
+    const size_t prefaultStackBytes = 128 * 1024;
+    volatile uint8_t stack[prefaultStackBytes];
+    
+    for(size_t i = 0; i < prefaultStackBytes; i += 4096)
+    {
+        stack[i] = 0;
+    }
+    
+    (void)stack;
 }
 
 void HighPrecisionTimer::Stop()
@@ -96,13 +373,78 @@ void HighPrecisionTimer::Stop()
     }
     
     timerThreadRunning = false;
+    MarkScheduleDirty(); // wakes the timer thread
     timerThread->join();
     delete timerThread;
     timerThread = nullptr;
     
+    // then stop the dispatch threads, dropping whatever pings they still had pending
+    delegateSetMutex.lock();
+    PruneDelegateSet();
+    for(DelegateSetIterator iter = delegateSet.begin(); iter != delegateSet.end(); iter++)
+    {
+        RetireDispatchWorker(iter->get(), true);
+    }
+    dispatchWorkersRunning = false;
+    PublishSnapshot();
+    ReapDispatchWorkers(true);
+    delegateSetMutex.unlock();
+    
+    statisticsMutex.lock();
+    statisticsRunNanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - timerThreadStart).count();
+    statisticsMutex.unlock();
+    
+    if(dumpStatisticsOnStop)
+    {
+        DumpStatistics();
+    }
+    
     return;
 }
 
+void HighPrecisionTimer::ResetStatistics()
+{
+    // NOTE: 'delegateSetMutex' is held by the caller
+    statisticsFires = 0;
+    statisticsTotalLatenessNanoseconds = 0;
+    statisticsMaxLatenessNanoseconds = 0;
+    statisticsRunNanoseconds = 0;
+    statisticsSleepNanoseconds = 0;
+    statisticsSpinNanoseconds = 0;
+    statisticsWakeMarginNanoseconds = 0;
+    
+    for(DelegateSetIterator iter = delegateSet.begin(); iter != delegateSet.end(); iter++)
+    {
+        iter->get()->pingStatistics.load()->Reset();
+    }
+    
+    statisticsMutex.lock();
+    timerThreadStart = std::chrono::steady_clock::now();
+    statisticsMutex.unlock();
+}
+
+void HighPrecisionTimer::DumpStatistics()
+{
+    std::lock_guard<std::mutex> lock(delegateSetMutex);
+    
+    for(DelegateSetIterator iter = delegateSet.begin(); iter != delegateSet.end(); iter++)
+    {
+        DelegateStatistics delegateStatistics = GetDelegateStatistics(*iter);
+        
+        printf("HighPrecisionTimer %s pings:%llu lateness usec p50:%f p99:%f p99.9:%f max:%f - jitter usec p50:%f p99:%f p99.9:%f max:%f\n",
+               iter->get()->TimerDelegateName(),
+               (unsigned long long)delegateStatistics.lateness.count,
+               delegateStatistics.lateness.p50Nanoseconds / 1000.0,
+               delegateStatistics.lateness.p99Nanoseconds / 1000.0,
+               delegateStatistics.lateness.p999Nanoseconds / 1000.0,
+               delegateStatistics.lateness.maxNanoseconds / 1000.0,
+               delegateStatistics.jitter.p50Nanoseconds / 1000.0,
+               delegateStatistics.jitter.p99Nanoseconds / 1000.0,
+               delegateStatistics.jitter.p999Nanoseconds / 1000.0,
+               delegateStatistics.jitter.maxNanoseconds / 1000.0);
+    }
+}
+
 bool HighPrecisionTimer::AddDelegate(std::shared_ptr<HighPrecisionTimer::Delegate> timerDelegate)
 {
     std::lock_guard<std::mutex> lock(delegateSetMutex);
@@ -112,7 +454,35 @@ bool HighPrecisionTimer::AddDelegate(std::shared_ptr<HighPrecisionTimer::Delegat
         return false;
     }
     
+    // NOTE: a delegate that was fired for the last time is still in delegateSet (the timer thread cannot take it
+    //       out), and may well be being added back
+    bool pruned = PruneDelegateSet();
+    
     DelegateSetInsertionPair insertaionPair = delegateSet.insert(timerDelegate);
+    if(insertaionPair.second)
+    {
+        timerDelegate->timer = this;
+        
+        if(timerDelegate->pingStatistics.load() == nullptr)
+        {
+            timerDelegate->pingStatistics = new Delegate::PingStatistics();
+        }
+        
+        // start the delegate's schedule from now, rather than from whenever it was last pinged (if ever), which
+        // for a MissedDeadlinePolicy_CatchUp delegate would mean a ping for every period since then. Start() and
+        // LastPing() move it on from here as ever
+        timerDelegate->Rephase(clock->Now());
+        
+        if(dispatchWorkersRunning)
+        {
+            StartDispatchWorker(timerDelegate);
+        }
+    }
+    
+    if(insertaionPair.second || pruned)
+    {
+        PublishSnapshot();
+    }
    
     return insertaionPair.second;
 }
@@ -126,13 +496,23 @@ bool HighPrecisionTimer::RemoveDelegate(std::shared_ptr<HighPrecisionTimer::Dele
         return false;
     }
     
+    bool pruned = PruneDelegateSet();
+    
     DelegateSetIterator iter = delegateSet.find(timerDelegate);
     if(iter == delegateSet.end())
     {
+        if(pruned)
+        {
+            PublishSnapshot();
+        }
+        
         return false;
     }
     
+    timerDelegate->timer = nullptr;
+    RetireDispatchWorker(timerDelegate.get(), true);
     delegateSet.erase(iter);
+    PublishSnapshot();
     
     return true;
 }
@@ -141,50 +521,765 @@ bool HighPrecisionTimer::RemoveAllDelegates()
 {
     std::lock_guard<std::mutex> lock(delegateSetMutex);
     
+    PruneDelegateSet();
+    
+    for(DelegateSetIterator iter = delegateSet.begin(); iter != delegateSet.end(); iter++)
+    {
+        iter->get()->timer = nullptr;
+        RetireDispatchWorker(iter->get(), true);
+    }
+    
     delegateSet.clear();
+    PublishSnapshot();
 
     return true;
 }
 
-void HighPrecisionTimer::TimerThreadProc(HighPrecisionTimer *highPrecisionTimer)
+HighPrecisionTimer::TimerStatistics HighPrecisionTimer::GetStatistics()
 {
-    if(highPrecisionTimer == nullptr)
+    TimerStatistics timerStatistics;
+    
+    timerStatistics.fires = statisticsFires;
+    timerStatistics.totalLatenessNanoseconds = statisticsTotalLatenessNanoseconds;
+    timerStatistics.maxLatenessNanoseconds = statisticsMaxLatenessNanoseconds;
+    timerStatistics.runNanoseconds = statisticsRunNanoseconds;
+    timerStatistics.sleepNanoseconds = statisticsSleepNanoseconds;
+    timerStatistics.spinNanoseconds = statisticsSpinNanoseconds;
+    timerStatistics.wakeMarginNanoseconds = statisticsWakeMarginNanoseconds;
+    
+    std::lock_guard<std::mutex> lock(statisticsMutex);
+    if(timerThreadRunning)
+    {
+        timerStatistics.runNanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - timerThreadStart).count();
+    }
+    
+    return timerStatistics;
+}
+
+HighPrecisionTimer::DelegateStatistics HighPrecisionTimer::GetDelegateStatistics(std::shared_ptr<HighPrecisionTimer::Delegate> timerDelegate)
+{
+    DelegateStatistics delegateStatistics;
+    Delegate::PingStatistics *pingStatistics = timerDelegate != nullptr ? timerDelegate->pingStatistics.load() : nullptr;
+    
+    // never added to a timer
+    if(pingStatistics == nullptr)
+    {
+        return delegateStatistics;
+    }
+    
+    delegateStatistics.pings = pingStatistics->pings;
+    delegateStatistics.totalLatenessNanoseconds = pingStatistics->totalLatenessNanoseconds;
+    delegateStatistics.maxLatenessNanoseconds = pingStatistics->maxLatenessNanoseconds;
+    delegateStatistics.droppedPings = pingStatistics->droppedPings;
+    delegateStatistics.lateness = pingStatistics->latenessHistogram.Summarize();
+    delegateStatistics.jitter = pingStatistics->jitterHistogram.Summarize();
+    
+    return delegateStatistics;
+}
+
+void HighPrecisionTimer::StartDispatchWorker(const DelegateSetValue &timerDelegate)
+{
+    // NOTE: 'delegateSetMutex' is held by the caller
+    DispatchWorker *dispatchWorker = new (std::nothrow) DispatchWorker(this, timerDelegate);
+    
+    if(dispatchWorker == nullptr || !dispatchWorker->Start(DispatchThreadPolicy()))
     {
+        // the delegate is still pinged, just inline
+        printf("Failed to start dispatch thread!!! Delegate will be pinged by the timer thread\n");
+        delete dispatchWorker;
         return;
     }
     
-    std::chrono::high_resolution_clock::time_point now;
-    std::chrono::duration<float> deltaFloatingPointSeconds;
+    timerDelegate->dispatchWorker = dispatchWorker;
+}
+
+void HighPrecisionTimer::RetireDispatchWorker(Delegate *timerDelegate, bool cancel)
+{
+    // NOTE: 'delegateSetMutex' is held by the caller, who is to publish a snapshot w/o the delegate straight after
+    if(timerDelegate->dispatchWorker == nullptr)
+    {
+        return;
+    }
     
-    while(highPrecisionTimer->timerThreadRunning)
+    if(cancel)
     {
-        highPrecisionTimer->delegateSetMutex.lock();
-        for(DelegateSetIterator iter = highPrecisionTimer->delegateSet.begin(); iter != highPrecisionTimer->delegateSet.end(); iter++)
+        timerDelegate->dispatchWorker->Cancel();
+    }
+    
+    retiredDispatchWorkers.push_back(RetiredDispatchWorker(timerDelegate->dispatchWorker, snapshotGeneration + 1));
+    timerDelegate->dispatchWorker = nullptr;
+}
+
+void HighPrecisionTimer::ReapDispatchWorkers(bool all)
+{
+    // NOTE: 'delegateSetMutex' is held by the caller
+    // NOTE: unless 'all', a worker is only deleted once its thread is done, such that this never waits on a TimerPing()
+    RetiredDispatchWorkers::iterator iter = retiredDispatchWorkers.begin();
+    
+    while(iter != retiredDispatchWorkers.end())
+    {
+        if(all || (iter->first->Finished() && SnapshotInUseSince(iter->second)))
         {
-            now = std::chrono::high_resolution_clock::now();
-            deltaFloatingPointSeconds = now - iter->get()->LastPing();
-            
-            if(deltaFloatingPointSeconds.count() > iter->get()->TimerPeriod())
-            {
-                iter->get()->TimerPing();
-                iter->get()->LastPing(now);
-                
-                if(iter->get()->FireOnce() || !iter->get()->Running())
-                {
-                    highPrecisionTimer->delegateSet.erase(iter);
-                }
-            }
+            delete iter->first; // stops it
+            iter = retiredDispatchWorkers.erase(iter);
         }
-        highPrecisionTimer->delegateSetMutex.unlock();
-        
-        // Apple can handle this thread getting kicked out of the processor.
-        // Windows CANNOT handle this thread getting kicked out of the processor even when the threadPriority is HIGHEST or TIME_CRITICAL!!!
-#if defined(__APPLE__)
-        //std::this_thread::sleep_for(std::chrono::milliseconds(1));
-        std::this_thread::sleep_for(std::chrono::microseconds(250));
-#endif
+        else
+        {
+            iter++;
+        }
+    }
+}
+
+void HighPrecisionTimer::Dispatch(const SnapshotEntry &snapshotEntry, int64_t deadline, const Clock::TimePoint &now)
+{
+    Delegate *timerDelegate = snapshotEntry.timerDelegate.get();
+    
+    if(snapshotEntry.dispatchWorker == nullptr)
+    {
+        RecordPing(timerDelegate, deadline, Nanoseconds(now));
+        timerDelegate->TimerPing();
+        return;
+    }
+    
+    if(!snapshotEntry.dispatchWorker->Post(deadline))
+    {
+        timerDelegate->pingStatistics.load()->droppedPings.fetch_add(1, std::memory_order_relaxed);
     }
 }
-                                                         
-                                                         
 
+void HighPrecisionTimer::RecordPing(Delegate *timerDelegate, int64_t deadline, int64_t pinged)
+{
+    Delegate::PingStatistics *pingStatistics = timerDelegate->pingStatistics.load();
+    uint64_t latenessNanoseconds = pinged > deadline ? pinged - deadline : 0;
+    
+    pingStatistics->latenessHistogram.Record(latenessNanoseconds);
+    if(pingStatistics->lastLatenessNanoseconds >= 0)
+    {
+        pingStatistics->jitterHistogram.Record((uint64_t)std::llabs((int64_t)latenessNanoseconds - pingStatistics->lastLatenessNanoseconds));
+    }
+    pingStatistics->lastLatenessNanoseconds = (int64_t)latenessNanoseconds;
+    
+    pingStatistics->pings.fetch_add(1, std::memory_order_relaxed);
+    pingStatistics->totalLatenessNanoseconds.fetch_add(latenessNanoseconds, std::memory_order_relaxed);
+    AtomicMax(pingStatistics->maxLatenessNanoseconds, latenessNanoseconds);
+}
+
+bool HighPrecisionTimer::DispatchWorker::Start(const ThreadPolicy &policy)
+{
+    ThreadPolicyResult result;
+    
+    // deep enough for a CatchUp delegate to fall a good many periods behind before anything is dropped
+    const size_t maxPendingDeadlines = 64;
+    
+    if(!pendingDeadlines.Allocate(maxPendingDeadlines))
+    {
+        return false;
+    }
+    
+    running = true;
+    finished = false;
+    thread = new (std::nothrow) std::thread(DispatchThreadProc, this);
+    if(thread == nullptr)
+    {
+        running = false;
+        return false;
+    }
+    
+    ApplyThreadPolicy(thread, policy, result);
+    
+    return true;
+}
+
+bool HighPrecisionTimer::DispatchWorker::Post(int64_t deadline)
+{
+    bool posted = false;
+    
+    mutex.lock();
+    
+    // NOTE: once retired or cancelled, the worker takes no more
+    if(running)
+    {
+        // a Skip delegate is pinged once for however many deadlines it has fallen behind, so there is no
+        // use in queueing another ping while one is still pending
+        if(!(timerDelegate->MissedDeadlines() == Delegate::MissedDeadlinePolicy_Skip && !pendingDeadlines.Empty()))
+        {
+            posted = pendingDeadlines.Push(deadline);
+        }
+    }
+    
+    mutex.unlock();
+    
+    if(posted)
+    {
+        condition.notify_one();
+    }
+    
+    return posted;
+}
+
+void HighPrecisionTimer::DispatchWorker::Retire()
+{
+    mutex.lock();
+    running = false;
+    mutex.unlock();
+    
+    condition.notify_one();
+}
+
+void HighPrecisionTimer::DispatchWorker::Cancel()
+{
+    mutex.lock();
+    pendingDeadlines.Clear();
+    running = false;
+    mutex.unlock();
+    
+    condition.notify_one();
+}
+
+void HighPrecisionTimer::DispatchWorker::Stop()
+{
+    if(thread == nullptr)
+    {
+        return;
+    }
+    
+    Cancel();
+    
+    thread->join();
+    delete thread;
+    thread = nullptr;
+}
+
+void HighPrecisionTimer::DispatchWorker::DispatchThreadProc(DispatchWorker *dispatchWorker)
+{
+    if(dispatchWorker == nullptr)
+    {
+        return;
+    }
+    
+    Delegate *timerDelegate = dispatchWorker->timerDelegate.get();
+    int64_t deadline = 0;
+    
+    if(dispatchWorker->timer->threadPolicyResult.memoryLocked)
+    {
+        PrefaultStack();
+    }
+    
+    std::unique_lock<std::mutex> lock(dispatchWorker->mutex);
+    
+    while(true)
+    {
+        dispatchWorker->condition.wait(lock, [dispatchWorker]() { return !dispatchWorker->pendingDeadlines.Empty() || !dispatchWorker->running; });
+        
+        // once retired, whatever is still pending gets pinged before finishing
+        if(dispatchWorker->pendingDeadlines.Empty())
+        {
+            break;
+        }
+        
+        deadline = dispatchWorker->pendingDeadlines.Front();
+        dispatchWorker->pendingDeadlines.PopFront();
+        
+        lock.unlock();
+        
+        dispatchWorker->timer->RecordPing(timerDelegate, deadline, Nanoseconds(dispatchWorker->timer->clock->Now()));
+        timerDelegate->TimerPing();
+        
+        lock.lock();
+    }
+    
+    dispatchWorker->finished = true;
+}
+
+void HighPrecisionTimer::PublishSnapshot()
+{
+    // NOTE: 'delegateSetMutex' is held by the caller
+    DelegateSnapshot *snapshot = new (std::nothrow) DelegateSnapshot();
+    
+    if(snapshot == nullptr)
+    {
+        printf("Failed to allocate delegate snapshot!!! Timer carries on w/ the delegates as they were\n");
+        return;
+    }
+    
+    snapshot->generation = ++snapshotGeneration;
+    snapshot->entries.reserve(delegateSet.size());
+    for(DelegateSetIterator iter = delegateSet.begin(); iter != delegateSet.end(); iter++)
+    {
+        snapshot->entries.push_back(SnapshotEntry(*iter, iter->get()->dispatchWorker));
+    }
+    
+    DelegateSnapshot *replacedSnapshot = publishedSnapshot.exchange(snapshot);
+    if(replacedSnapshot != nullptr)
+    {
+        retiredSnapshots.push_back(replacedSnapshot);
+    }
+    
+    // have the timer thread pick the new snapshot up now, rather than at its next deadline, such
+    // that the snapshot it lets go of can be freed (along w/ any dispatch threads that it refers to)
+    MarkScheduleDirty();
+    
+    ReclaimSnapshots(false);
+    ReapDispatchWorkers(false);
+}
+
+void HighPrecisionTimer::ReclaimSnapshots(bool all)
+{
+    // NOTE: 'delegateSetMutex' is held by the caller
+    DelegateSnapshot *inUse = snapshotInUse.load();
+    DelegateSnapshots::iterator iter = retiredSnapshots.begin();
+    
+    while(iter != retiredSnapshots.end())
+    {
+        if(all || *iter != inUse)
+        {
+            delete *iter;
+            iter = retiredSnapshots.erase(iter);
+        }
+        else
+        {
+            iter++;
+        }
+    }
+}
+
+bool HighPrecisionTimer::SnapshotInUseSince(uint64_t generation)
+{
+    // NOTE: 'delegateSetMutex' is held by the caller, which is what keeps the snapshot in use from being freed
+    DelegateSnapshot *inUse = snapshotInUse.load();
+    
+    return inUse == nullptr || inUse->generation >= generation;
+}
+
+bool HighPrecisionTimer::PruneDelegateSet()
+{
+    // NOTE: 'delegateSetMutex' is held by the caller
+    // take out every delegate that the timer thread has fired for the last time, whose dispatch threads (having
+    // been retired by the timer thread, so as to still ping whatever was pending) are left to finish up
+    bool pruned = false;
+    DelegateSetIterator iter = delegateSet.begin();
+    
+    while(iter != delegateSet.end())
+    {
+        if(iter->get()->timer.load() != this)
+        {
+            RetireDispatchWorker(iter->get(), false);
+            iter = delegateSet.erase(iter);
+            pruned = true;
+        }
+        else
+        {
+            iter++;
+        }
+    }
+    
+    return pruned;
+}
+
+HighPrecisionTimer::DelegateSnapshot* HighPrecisionTimer::AcquireSnapshot()
+{
+    // NOTE: only ever called from the timer thread (or from whoever Step()s the timer)
+    // announce the snapshot before going anywhere near it, then make sure that it is still the published one, as
+    // it may otherwise have been replaced (and freed, seeing as it was not yet announced) in the meantime. Once
+    // announced and still published, it is never freed for as long as it is announced
+    DelegateSnapshot *snapshot = nullptr;
+    
+    do
+    {
+        snapshot = publishedSnapshot.load();
+        snapshotInUse.store(snapshot);
+    } while(snapshot != publishedSnapshot.load());
+    
+    return snapshot;
+}
+
+void HighPrecisionTimer::MarkScheduleDirty()
+{
+    // NOTE: may be called from within TimerPing(), so this must never take 'delegateSetMutex' (not that the timer
+    //       thread itself ever holds it anymore)
+    scheduleMutex.lock();
+    scheduleDirty = true;
+    scheduleMutex.unlock();
+    
+    scheduleCondition.notify_one();
+}
+
+void HighPrecisionTimer::RebuildSchedule(DelegateSnapshot *snapshot)
+{
+    // NOTE: only ever called from the timer thread (or from whoever Step()s the timer)
+    int64_t now = Nanoseconds(clock->Now());
+    
+    ClearSchedule(now);
+    
+    if(snapshot == nullptr)
+    {
+        return;
+    }
+    
+    if(scheduleBackend == ScheduleBackend_Wheel)
+    {
+        scheduleWheel.Reserve(snapshot->entries.size());
+    }
+    
+    for(size_t i = 0; i < snapshot->entries.size(); i++)
+    {
+        const SnapshotEntry &snapshotEntry = snapshot->entries[i];
+        Delegate *timerDelegate = snapshotEntry.timerDelegate.get();
+        
+        // already removed, or fired for the last time
+        if(timerDelegate->timer.load() != this)
+        {
+            continue;
+        }
+        
+        Delegate::SchedulePeriod period = CurrentPeriod(timerDelegate);
+        
+        if(timerDelegate->scheduleRephase.exchange(false))
+        {
+            // start the schedule over, one period on from the ping that was set from outside
+            timerDelegate->scheduleAnchor = timerDelegate->rephaseAnchorNanoseconds.load();
+            timerDelegate->scheduleTicks = 1;
+            timerDelegate->schedulePeriod = period;
+        }
+        else if(period != timerDelegate->schedulePeriod)
+        {
+            // carry on from the last deadline, at the new period
+            timerDelegate->scheduleTicks--;
+            timerDelegate->scheduleAnchor = Deadline(timerDelegate);
+            timerDelegate->scheduleTicks = 1;
+            timerDelegate->schedulePeriod = period;
+        }
+        
+        // NOTE: a delegate that is already overdue (say, its period was just shortened) is due now, rather than
+        //       at some point in the past, which would otherwise count against the timer's lateness
+        InsertSchedule(ScheduleEntry(std::max(Deadline(timerDelegate), now), &snapshotEntry));
+    }
+}
+
+void HighPrecisionTimer::ClearSchedule(int64_t now)
+{
+    // NOTE: clears both, such that neither keeps hold of a snapshot entry after the backend has been switched
+    schedule.clear();
+    scheduleWheel.Clear(now);
+}
+
+void HighPrecisionTimer::InsertSchedule(const ScheduleEntry &scheduleEntry)
+{
+    if(scheduleBackend == ScheduleBackend_Wheel)
+    {
+        scheduleWheel.Insert(scheduleEntry.deadline, scheduleEntry.snapshotEntry);
+        return;
+    }
+    
+    schedule.push_back(scheduleEntry);
+    std::push_heap(schedule.begin(), schedule.end());
+}
+
+bool HighPrecisionTimer::PopDueSchedule(int64_t now, ScheduleEntry &scheduleEntry)
+{
+    if(scheduleBackend == ScheduleBackend_Wheel)
+    {
+        return scheduleWheel.PopDue(now, scheduleEntry.deadline, scheduleEntry.snapshotEntry);
+    }
+    
+    if(schedule.empty() || schedule.front().deadline > now)
+    {
+        return false;
+    }
+    
+    std::pop_heap(schedule.begin(), schedule.end());
+    scheduleEntry = schedule.back();
+    schedule.pop_back();
+    
+    return true;
+}
+
+bool HighPrecisionTimer::NextScheduleDeadline(int64_t &deadline)
+{
+    if(scheduleBackend == ScheduleBackend_Wheel)
+    {
+        return scheduleWheel.NextDeadline(deadline);
+    }
+    
+    if(schedule.empty())
+    {
+        return false;
+    }
+    
+    deadline = schedule.front().deadline;
+    
+    return true;
+}
+
+void HighPrecisionTimer::WaitUntil(const Clock::TimePoint &deadline, bool spinTail)
+{
+    Clock::TimePoint waitStart = clock->Now();
+#if defined(_WIN32)
+    // Windows CANNOT handle this thread getting kicked out of the processor even when the threadPriority is HIGHEST
+    // or TIME_CRITICAL!!! A learned margin only reacts to a late wake-up after the fact, so the thread never sleeps
+    // ahead of a deadline there, and spins out the whole wait (it still sleeps while there is nothing to fire)
+    Clock::TimePoint wakeTarget = spinTail ? waitStart : deadline;
+#else
+    Clock::TimePoint wakeTarget = spinTail ? deadline - wakeMargin : deadline;
+#endif
+    Clock::TimePoint spinStart = waitStart;
+    bool interrupted = false;
+    
+    // sleep until just short of the deadline, unless something changes the schedule first
+    // NOTE: the wait is against steady_clock, so that the sleep is to an absolute deadline on a monotonic clock
+    if(wakeTarget > waitStart)
+    {
+        std::chrono::steady_clock::time_point steadyWakeTarget = std::chrono::steady_clock::now() + (wakeTarget - waitStart);
+        
+        std::unique_lock<std::mutex> scheduleLock(scheduleMutex);
+        interrupted = scheduleCondition.wait_until(scheduleLock, steadyWakeTarget, [this]() { return scheduleDirty.load(); });
+        scheduleLock.unlock();
+        
+        spinStart = clock->Now();
+        
+        if(!interrupted)
+        {
+            LearnWakeOvershoot(std::chrono::duration_cast<std::chrono::nanoseconds>(spinStart - wakeTarget));
+        }
+    }
+    
+    // spin out the remainder, which is only ever about as long as the OS's wake-up jitter
+    if(spinTail && !interrupted)
+    {
+        while(clock->Now() < deadline && !scheduleDirty)
+        {
+            
+        }
+    }
+    
+    statisticsSleepNanoseconds.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(spinStart - waitStart).count(), std::memory_order_relaxed);
+    statisticsSpinNanoseconds.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(clock->Now() - spinStart).count(), std::memory_order_relaxed);
+    statisticsWakeMarginNanoseconds.store(wakeMargin.count(), std::memory_order_relaxed);
+}
+
+void HighPrecisionTimer::LearnWakeOvershoot(const std::chrono::nanoseconds &overshoot)
+{
+    // track the mean and mean deviation of the overshoot, and stop sleeping far enough ahead
+    // of the deadline to cover all but the rarest of late wake-ups
+    // NOTE: the rare wake-up that is hundreds of usec late (the thread was preempted) would otherwise
+    //       drag the margin way up for a long while, so each sample is clipped to a few margins' worth,
+    //       which still lets the margin grow quickly on an OS that is late to wake as a matter of course
+    double sample = std::min((double)overshoot.count(), 4.0 * wakeMargin.count());
+    
+    wakeOvershootAverage += (sample - wakeOvershootAverage) / 16.0;
+    wakeOvershootDeviation += (std::fabs(sample - wakeOvershootAverage) - wakeOvershootDeviation) / 16.0;
+    
+    std::chrono::nanoseconds margin((int64_t)(wakeOvershootAverage + 4.0 * wakeOvershootDeviation));
+    wakeMargin = std::min(std::max(margin, minWakeMargin), maxWakeMargin);
+}
+
+HighPrecisionTimer::Delegate::SchedulePeriod HighPrecisionTimer::CurrentPeriod(Delegate *timerDelegate)
+{
+    Delegate::SchedulePeriod period;
+    
+    // NOTE: one call, such that the rational period can never be from a different SetTimerPeriod() than 'seconds'
+    period.seconds = timerDelegate->TimerPeriodExact(period.numerator, period.timeScale);
+    if(period.numerator == 0 || period.timeScale == 0)
+    {
+        period.numerator = 0;
+        period.timeScale = 0;
+    }
+    
+    return period;
+}
+
+int64_t HighPrecisionTimer::Deadline(Delegate *timerDelegate)
+{
+    const Delegate::SchedulePeriod &period = timerDelegate->schedulePeriod;
+    
+    // NOTE: always computed from the anchor, rather than by adding one period after another, so that
+    //       rounding to whole nanoseconds never adds up
+    if(period.timeScale != 0)
+    {
+        // exact: n * numerator / timeScale seconds, in integer math, split into whole seconds and the
+        // remainder so that n * numerator * 1e9 never has to be formed (and never overflows)
+        uint64_t units = timerDelegate->scheduleTicks * period.numerator;
+        uint64_t wholeSeconds = units / period.timeScale;
+        uint64_t remainder = units % period.timeScale;
+        
+        return timerDelegate->scheduleAnchor + (int64_t)(wholeSeconds * 1000000000ULL + (remainder * 1000000000ULL) / period.timeScale);
+    }
+    
+    // a double holds n * period * 1e9 to well under a nanosecond for years' worth of nanoseconds
+    return timerDelegate->scheduleAnchor + llround(timerDelegate->scheduleTicks * period.seconds * 1000000000.0);
+}
+
+void HighPrecisionTimer::AdvanceSchedule(Delegate *timerDelegate, int64_t firedDeadline, int64_t now)
+{
+    // NOTE: only ever called from the timer thread (or from whoever Step()s the timer)
+    Delegate::SchedulePeriod period = CurrentPeriod(timerDelegate);
+    
+    // the delegate may well have changed its period from within TimerPing(), in which case the new
+    // period runs from the deadline that was just fired
+    if(period != timerDelegate->schedulePeriod)
+    {
+        timerDelegate->scheduleAnchor = firedDeadline;
+        timerDelegate->scheduleTicks = 0;
+        timerDelegate->schedulePeriod = period;
+    }
+    
+    timerDelegate->scheduleTicks++;
+    
+    // if whole periods have gone by since the deadline that was just fired, either fire for each of them
+    // (by leaving the schedule be, as they are all due now) or skip ahead to the first that is yet to come
+    bool skip = timerDelegate->MissedDeadlines() == Delegate::MissedDeadlinePolicy_Skip;
+    
+    // NOTE: a CatchUp delegate that has fallen too far behind (say, the whole process was stalled for a second
+    //       or two) skips as well, rather than being fired for every last period of the stall back to back
+    uint32_t maxCatchUp = skip ? 0 : timerDelegate->MaxCatchUp();
+    if(maxCatchUp != 0 && period.seconds > 0 && Deadline(timerDelegate) <= now)
+    {
+        // (the one just fired, and every one that is still due, makes more than maxCatchUp)
+        skip = (now - Deadline(timerDelegate)) / (period.seconds * 1000000000.0) + 1 >= maxCatchUp;
+    }
+    
+    if(skip && Deadline(timerDelegate) <= now && period.seconds > 0)
+    {
+        // estimate, then settle on the exact tick
+        timerDelegate->scheduleTicks = (uint64_t)((now - timerDelegate->scheduleAnchor) / (period.seconds * 1000000000.0)) + 1;
+        
+        while(Deadline(timerDelegate) <= now)
+        {
+            timerDelegate->scheduleTicks++;
+        }
+    }
+}
+
+int64_t HighPrecisionTimer::Nanoseconds(const Clock::TimePoint &timePoint)
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(timePoint.time_since_epoch()).count();
+}
+
+Clock::TimePoint HighPrecisionTimer::TimePoint(int64_t nanoseconds)
+{
+    return Clock::TimePoint(std::chrono::duration_cast<Clock::Duration>(std::chrono::nanoseconds(nanoseconds)));
+}
+
+bool HighPrecisionTimer::FireDue(Clock::TimePoint &nextDeadline)
+{
+    // NOTE: only ever called from the timer thread, or from whoever Step()s the timer
+    // NOTE: no lock is held from here on through the pings, so neither does a delegate that is slow to
+    //       return from TimerPing() hold up AddDelegate() et al, nor the other way around
+    DelegateSnapshot *snapshot = AcquireSnapshot();
+    Clock::TimePoint now;
+    ScheduleEntry scheduleEntry;
+    int64_t deadline;
+    
+    if(scheduleDirty.exchange(false) || snapshot != scheduledSnapshot)
+    {
+        RebuildSchedule(snapshot);
+        scheduledSnapshot = snapshot;
+    }
+    
+    // fire every delegate that is due, earliest first (to within a tick, under ScheduleBackend_Wheel)
+    now = clock->Now();
+    while(PopDueSchedule(Nanoseconds(now), scheduleEntry))
+    {
+        const SnapshotEntry &snapshotEntry = *scheduleEntry.snapshotEntry;
+        Delegate *timerDelegate = snapshotEntry.timerDelegate.get();
+        
+        // removed since the snapshot was published
+        if(timerDelegate->timer.load() != this)
+        {
+            continue;
+        }
+        
+        uint64_t latenessNanoseconds = Nanoseconds(now) - scheduleEntry.deadline;
+        statisticsFires.fetch_add(1, std::memory_order_relaxed);
+        statisticsTotalLatenessNanoseconds.fetch_add(latenessNanoseconds, std::memory_order_relaxed);
+        AtomicMax(statisticsMaxLatenessNanoseconds, latenessNanoseconds);
+        
+        Dispatch(snapshotEntry, scheduleEntry.deadline, now);
+        timerDelegate->lastPingNanoseconds.store(Nanoseconds(now), std::memory_order_relaxed); // NOT LastPing(), which would start the delegate's schedule over
+        
+        now = clock->Now();
+        
+        if(timerDelegate->FireOnce() || !timerDelegate->Running())
+        {
+            // leave the delegate's dispatch thread to ping whatever is still pending, then leave the timer (the
+            // delegate is taken out of delegateSet by the next AddDelegate() et al, see PruneDelegateSet())
+            if(snapshotEntry.dispatchWorker != nullptr)
+            {
+                snapshotEntry.dispatchWorker->Retire();
+            }
+            
+            HighPrecisionTimer *expectedTimer = this;
+            timerDelegate->timer.compare_exchange_strong(expectedTimer, nullptr);
+        }
+        else
+        {
+            AdvanceSchedule(timerDelegate, Deadline(timerDelegate), Nanoseconds(now));
+            scheduleEntry.deadline = Deadline(timerDelegate);
+            InsertSchedule(scheduleEntry);
+        }
+    }
+    
+    if(!NextScheduleDeadline(deadline))
+    {
+        return false;
+    }
+    
+    nextDeadline = TimePoint(deadline);
+    
+    return true;
+}
+
+bool HighPrecisionTimer::Step(Clock::TimePoint &nextDeadline)
+{
+    std::lock_guard<std::mutex> lock(timerMutex);
+    
+    if(timerThread != nullptr)
+    {
+        return false;
+    }
+    
+    return FireDue(nextDeadline);
+}
+
+void HighPrecisionTimer::TimerThreadProc(HighPrecisionTimer *highPrecisionTimer)
+{
+    if(highPrecisionTimer == nullptr)
+    {
+        return;
+    }
+    
+    Clock::TimePoint nextDeadline;
+    bool spinTail = false;
+    
+    // when there is nothing to fire, how long to wait before looking again (anything that
+    // changes the schedule wakes the thread early)
+    const std::chrono::milliseconds idleWait(100);
+    
+    if(highPrecisionTimer->threadPolicyResult.memoryLocked)
+    {
+        PrefaultStack();
+    }
+    
+#if defined(__linux__)
+    // Linux pads every timed sleep of a non-realtime thread by its timer slack (50us by default), which would
+    // otherwise be the bulk of the wake margin
+    prctl(PR_SET_TIMERSLACK, 1UL, 0, 0, 0);
+#endif
+    
+    while(highPrecisionTimer->timerThreadRunning)
+    {
+        spinTail = highPrecisionTimer->FireDue(nextDeadline);
+        if(!spinTail)
+        {
+            nextDeadline = highPrecisionTimer->clock->Now() + idleWait;
+        }
+        
+        // sleep, then spin, through to the next deadline (spin only, on Windows, see WaitUntil())
+        highPrecisionTimer->WaitUntil(nextDeadline, spinTail);
+    }
+    
+    // let go of the snapshot, such that it (and every one after it) can be freed
+    highPrecisionTimer->ClearSchedule(0);
+    highPrecisionTimer->scheduledSnapshot = nullptr;
+    highPrecisionTimer->snapshotInUse = nullptr;
+}
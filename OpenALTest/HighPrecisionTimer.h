@@ -26,63 +26,418 @@
 #define HighPrecisionTimer_h
 
 #include <iostream>
+#include <cstdint>
 #include <memory>
 #include <thread>
 #include <chrono>
 #include <mutex>
+#include <condition_variable>
+#include <atomic>
 #include <set>
+#include <vector>
 #include <iterator>
 
+#include "Clock.h"
+#include "RingBuffer.h"
+#include "LatenessHistogram.h"
+#include "TimerWheel.h"
+
 class HighPrecisionTimer
 {
+    class DispatchWorker;
+    
 public:
+    // How delegates are pinged
+    enum DispatchMode
+    {
+        DispatchMode_Inline = 0, // the timer thread calls TimerPing() itself, one delegate after another
+        DispatchMode_Threaded,   // the timer thread only keeps time, and wakes a thread of each delegate's own to call TimerPing()
+    };
+    
+    // How the timer thread keeps delegates in order of when they are next due
+    enum ScheduleBackend
+    {
+        ScheduleBackend_Heap = 0, // binary min-heap, O(log n) to insert and to expire a deadline
+        ScheduleBackend_Wheel,    // hierarchical timing wheel, O(1) to insert and to expire a deadline (see TimerWheel.h)
+    };
+    
+    // per-delegate accounting, such that a delegate that is pinged late can be told apart from the others
+    class DelegateStatistics
+    {
+    public:
+        DelegateStatistics() : pings(0), totalLatenessNanoseconds(0), maxLatenessNanoseconds(0), droppedPings(0) {}
+        
+        uint64_t pings;                    // TimerPing() calls
+        uint64_t totalLatenessNanoseconds; // total time between when the delegate was due and when TimerPing() was called
+        uint64_t maxLatenessNanoseconds;
+        uint64_t droppedPings;             // deadlines that came due while the delegate's dispatch thread was still behind, and were never pinged
+        
+        LatenessHistogram::Summary lateness; // of every ping
+        LatenessHistogram::Summary jitter;   // how much the lateness changed from one ping to the next
+    };
+    
     class Delegate
     {
     public:
-        Delegate() : timerRunning(true) { }
-        virtual ~Delegate() { }
+        enum MissedDeadlinePolicy
+        {
+            MissedDeadlinePolicy_Skip = 0, // fire once for however many periods were missed, then carry on from the next one due
+            MissedDeadlinePolicy_CatchUp,  // fire once for every period that was missed, back to back (up to MaxCatchUp() of them)
+        };
+        
+        Delegate() : timerRunning(true), lastPingNanoseconds(0), timer(nullptr), scheduleAnchor(0), scheduleTicks(0), scheduleRephase(true), rephaseAnchorNanoseconds(0), pingStatistics(nullptr), dispatchWorker(nullptr) { }
+        virtual ~Delegate() { delete pingStatistics.load(); }
     
         virtual void Kill() { timerRunning = false; }
         virtual bool Running() { return timerRunning; }
-        virtual void LastPing(const std::chrono::high_resolution_clock::time_point &lp) { lastPing = lp; }
-        virtual void RefreshLastPing() { lastPing = std::chrono::high_resolution_clock::now(); }
-        virtual std::chrono::high_resolution_clock::time_point LastPing() { return lastPing; }
+        virtual void LastPing(const Clock::TimePoint &lp) { Rephase(lp); }
+        virtual void RefreshLastPing() { Rephase(TimerNow()); }
+        virtual Clock::TimePoint LastPing() { return TimePoint(lastPingNanoseconds.load()); }
         
         virtual void TimerPing() = 0; // gets called when timer fires
         virtual double TimerPeriod() = 0; // in seconds
+        virtual double TimerPeriodExact(uint64_t &numerator, uint64_t &timeScale) { numerator = 0; timeScale = 0; return TimerPeriod(); } // TimerPeriod(), along w/ the exact period (e.g. 1001 / 30000 sec) if the delegate has one (0 / 0 if not), as of one and the same moment
         virtual bool FireOnce() = 0; // says to fire once or multiple times
+        virtual MissedDeadlinePolicy MissedDeadlines() { return MissedDeadlinePolicy_Skip; }
+        virtual uint32_t MaxCatchUp() { return 32; } // how many periods a CatchUp delegate may fall behind before it skips them, as a Skip delegate would (0 for no limit)
+        virtual const char* TimerDelegateName() { return "delegate"; } // for statistics
+        
+    protected:
+        // the timer only works out when a delegate is next due when it fires the delegate, so a delegate
+        // whose TimerPeriod() changes at any other time must call this for the change to take effect
+        // before the old deadline (LastPing() et al take care of calling it themselves)
+        void ScheduleChanged();
+        
+        // the time, by the clock of the timer that the delegate has been added to (or by the steady clock, if none)
+        Clock::TimePoint TimerNow();
         
     private:
+        friend class HighPrecisionTimer;
+        
         bool timerRunning;
-        std::chrono::high_resolution_clock::time_point lastPing;
+        std::atomic<int64_t> lastPingNanoseconds; // by the timer's clock, as of the last ping (or of LastPing(), if since)
+        std::atomic<HighPrecisionTimer*> timer; // the timer that the delegate has been added to (if any)
+        
+        // the delegate fires at scheduleAnchor + (n * schedulePeriod), for n = 1, 2, 3... rather than at one period
+        // after whenever it last actually fired, so that lateness never accumulates. scheduleAnchor is in integer
+        // nanoseconds of the timer's clock, and is moved (to the last deadline) only when the period changes,
+        // or (to rephaseAnchorNanoseconds) when LastPing() is set from outside of the timer
+        class SchedulePeriod
+        {
+        public:
+            SchedulePeriod() : seconds(0), numerator(0), timeScale(0) { }
+            
+            bool operator!=(const SchedulePeriod &rhs) const { return seconds != rhs.seconds || numerator != rhs.numerator || timeScale != rhs.timeScale; }
+            
+            double   seconds;
+            uint64_t numerator; // numerator / timeScale seconds, when timeScale != 0, in which case 'seconds' is informational only
+            uint64_t timeScale;
+        };
+        
+        int64_t           scheduleAnchor;
+        uint64_t          scheduleTicks;   // n, for the deadline that is next due
+        SchedulePeriod    schedulePeriod;
+        std::atomic<bool> scheduleRephase;
+        
+        // LastPing() may be set from any thread, so the new anchor is handed to the timer thread on a field of
+        // its own, which the timer only reads once it has seen (and cleared) scheduleRephase
+        std::atomic<int64_t> rephaseAnchorNanoseconds;
+        
+        void Rephase(const Clock::TimePoint &anchor)
+        {
+            rephaseAnchorNanoseconds = Nanoseconds(anchor);
+            lastPingNanoseconds = Nanoseconds(anchor);
+            scheduleRephase = true;
+            ScheduleChanged();
+        }
         
-        // TODO: May consider having TimerPing occur on a thread, so that a
-        //       client that blocks in TimerPing does not block all other clients.
-        //       HOWEVER, doing so will require even more threads, themselves which
-        //       ALSO need to be near realtime threads. We should do this only if we
-        //       need it, as each Delegate will require its own thread...
+        // lock free, such that recording a ping never waits on someone reading them
+        class PingStatistics
+        {
+        public:
+            PingStatistics() : pings(0), totalLatenessNanoseconds(0), maxLatenessNanoseconds(0), droppedPings(0), lastLatenessNanoseconds(-1) { }
+            
+            void Reset();
+            
+            std::atomic<uint64_t> pings;
+            std::atomic<uint64_t> totalLatenessNanoseconds;
+            std::atomic<uint64_t> maxLatenessNanoseconds;
+            std::atomic<uint64_t> droppedPings;
+            LatenessHistogram     latenessHistogram;
+            LatenessHistogram     jitterHistogram;
+            int64_t               lastLatenessNanoseconds; // -1 until first pinged, only touched by whichever thread pings the delegate
+        };
+        
+        // NOTE: allocated (off of the timer thread) when the delegate is first added to a timer, rather than by every
+        //       delegate up front, and then kept for as long as the delegate lives, such that a ping that is still
+        //       under way as the delegate is removed never finds it gone
+        std::atomic<PingStatistics*> pingStatistics;
+        DispatchWorker              *dispatchWorker; // the thread that pings the delegate under DispatchMode_Threaded (owned by the timer, guarded by its 'delegateSetMutex')
+    };
+    
+    // How the timer thread is to be scheduled, as applied by Start(). Anything that the OS refuses (e.g. realtime
+    // scheduling w/o the privilege for it) is skipped rather than failing Start(), and GetThreadPolicyResult()
+    // reports what was actually got
+    // NOTE: realtime is opt-in on Linux. A realtime thread that spins out the tail of every wait (see WaitUntil())
+    //       can starve everything else on its cpu, so it should be paired w/ a cpu of its own
+    class ThreadPolicy
+    {
+    public:
+#if defined(__linux__)
+        ThreadPolicy() : realtime(false), roundRobin(false), priority(-1), cpu(-1), lockMemory(false) {}
+#else
+        ThreadPolicy() : realtime(true), roundRobin(false), priority(-1), cpu(-1), lockMemory(false) {}
+#endif
+        
+        bool realtime;   // SCHED_FIFO (or SCHED_RR) rather than the default time-sharing policy
+        bool roundRobin; // SCHED_RR rather than SCHED_FIFO
+        int  priority;   // realtime priority, -1 for the highest that the policy allows
+        int  cpu;        // pin the thread to this cpu (Linux only), -1 to let it run anywhere (see FirstIsolatedCPU())
+        bool lockMemory; // mlockall() the process and prefault the timer thread's stack, so that it never page faults (Linux only)
+    };
+    
+    class ThreadPolicyResult
+    {
+    public:
+        ThreadPolicyResult() : realtime(false), roundRobin(false), priority(0), cpu(-1), memoryLocked(false) {}
+        
+        bool realtime;
+        bool roundRobin;
+        int  priority;     // the realtime priority, should 'realtime' be true
+        int  cpu;          // -1 if not pinned
+        bool memoryLocked;
     };
     
-    HighPrecisionTimer();
+    class TimerStatistics
+    {
+    public:
+        TimerStatistics() : fires(0), totalLatenessNanoseconds(0), maxLatenessNanoseconds(0), runNanoseconds(0), sleepNanoseconds(0), spinNanoseconds(0), wakeMarginNanoseconds(0) {}
+        
+        uint64_t fires;                    // deadlines fired (i.e. TimerPing() called, or handed to the delegate's dispatch thread)
+        uint64_t totalLatenessNanoseconds; // total time between when delegates were due and when they were fired
+        uint64_t maxLatenessNanoseconds;
+        uint64_t runNanoseconds;           // how long the timer thread has been running
+        uint64_t sleepNanoseconds;         // of which, time spent asleep (i.e. NOT burning a core)
+        uint64_t spinNanoseconds;          // of which, time spent spinning out the last of a wait
+        uint64_t wakeMarginNanoseconds;    // how far ahead of a deadline the thread currently stops sleeping
+    };
+    
+    // NOTE: a timer on a virtual clock is never Start()ed. Whoever advances the clock Step()s the timer instead
+    HighPrecisionTimer(std::shared_ptr<Clock> timerClock = nullptr); // nullptr for Clock::Steady()
     ~HighPrecisionTimer();
     
     bool Start();
+    
+    // fires every delegate that is due as of the clock's Now(), on the calling thread, and returns when the next
+    // is due (false if there is nothing to fire at all). Fails (as does Start()) while the timer is running
+    bool Step(Clock::TimePoint &nextDeadline);
+    
+    std::shared_ptr<Clock> GetClock() { return clock; }
+    
+    // NOTE: none of these ever wait on a TimerPing(), so a TimerPing() that was already under way when a delegate
+    //       is removed may still be running (or, under DispatchMode_Threaded, may only just be starting) after
+    //       RemoveDelegate() returns. Stop() first if the delegate must be left alone from then on
     bool AddDelegate(std::shared_ptr<HighPrecisionTimer::Delegate> timerDelegate);
     bool RemoveDelegate(std::shared_ptr<HighPrecisionTimer::Delegate> timerDelegate);
     bool RemoveAllDelegates();
     void Stop();
     
+    TimerStatistics GetStatistics();
+    DelegateStatistics GetDelegateStatistics(std::shared_ptr<HighPrecisionTimer::Delegate> timerDelegate); // may be called while running
+    void SetDumpStatisticsOnStop(bool dump) { dumpStatisticsOnStop = dump; } // prints every delegate's lateness percentiles (on by default)
+    
+    // NOTE: Threaded costs a thread per delegate (each w/ the timer's thread policy, one priority below the timer
+    //       thread itself), but a delegate that blocks in TimerPing() then only ever delays itself. Under Inline,
+    //       a delegate that blocks delays every other delegate as well
+    bool SetDispatchMode(DispatchMode mode); // fails once started
+    
+    // NOTE: the heap fires delegates that are due at the same time strictly earliest first, the wheel only to
+    //       within a tick (~1us) of one another. The wheel is for timers w/ hundreds of delegates and up
+    bool SetScheduleBackend(ScheduleBackend backend); // fails once started
+    
+    bool SetThreadPolicy(const ThreadPolicy &policy); // fails once started
+    ThreadPolicyResult GetThreadPolicyResult();
+    static int FirstIsolatedCPU(); // the first cpu that the kernel keeps the scheduler off of (i.e. isolcpus=), or -1 if there are none
+    
 private:
     typedef std::shared_ptr<HighPrecisionTimer::Delegate> DelegateSetValue;
     typedef std::set<DelegateSetValue> DelegateSet;
     typedef DelegateSet::iterator DelegateSetIterator;
     typedef std::pair<DelegateSetIterator, bool> DelegateSetInsertionPair;
     
-    DelegateSet delegateSet;
+    DelegateSet delegateSet; // never touched by the timer thread, which goes by the published snapshot of it instead
     std::mutex delegateSetMutex;
+    
+    // --- Snapshot
+    // every change to delegateSet (made while holding 'delegateSetMutex') publishes a new, immutable snapshot of it,
+    // which the timer thread picks up before its next pass. The timer thread thus pings w/o holding any lock that
+    // AddDelegate() et al could be waiting on. A snapshot that has been replaced is freed by a later change, once
+    // the timer thread has moved on from it (see AcquireSnapshot())
+    // NOTE: a delegate's 'timer' is cleared as it leaves the timer (be it removed, or fired for the last time), and
+    //       the timer thread skips any delegate in its snapshot whose 'timer' is no longer this one
+    class SnapshotEntry
+    {
+    public:
+        SnapshotEntry() : dispatchWorker(nullptr) { }
+        SnapshotEntry(const DelegateSetValue &td, DispatchWorker *dw) : timerDelegate(td), dispatchWorker(dw) { }
+        
+        DelegateSetValue timerDelegate;
+        DispatchWorker  *dispatchWorker;
+    };
+    
+    class DelegateSnapshot
+    {
+    public:
+        DelegateSnapshot() : generation(0) { }
+        
+        uint64_t                   generation;
+        std::vector<SnapshotEntry> entries;
+    };
+    
+    typedef std::vector<DelegateSnapshot*> DelegateSnapshots;
+    
+    std::atomic<DelegateSnapshot*> publishedSnapshot;
+    std::atomic<DelegateSnapshot*> snapshotInUse;      // by the timer thread (nullptr while it is not running)
+    DelegateSnapshots              retiredSnapshots;   // guarded by 'delegateSetMutex'
+    uint64_t                       snapshotGeneration; // guarded by 'delegateSetMutex'
+    
+    void PublishSnapshot();
+    void ReclaimSnapshots(bool all);
+    bool SnapshotInUseSince(uint64_t generation); // whether the timer thread has moved on to (at least) the given snapshot
+    bool PruneDelegateSet();
+    DelegateSnapshot* AcquireSnapshot();
+    
+    // --- Schedule
+    // every delegate in the timer thread's snapshot, ordered by when it is next due (in a min-heap, or in a timing
+    // wheel), such that the timer thread only ever looks at what is due rather than at every delegate on every pass.
+    // NOTE: only ever touched by the timer thread, which rebuilds it whenever it picks up a new snapshot, or
+    //       whenever something marks the schedule dirty (e.g. a delegate's period changed)
+    class ScheduleEntry
+    {
+    public:
+        ScheduleEntry() : deadline(0), snapshotEntry(nullptr) { }
+        ScheduleEntry(int64_t d, const SnapshotEntry *se) : deadline(d), snapshotEntry(se) { }
+        
+        // std::push_heap() et al build a max-heap, so order by later deadline to get a min-heap
+        bool operator<(const ScheduleEntry &rhs) const { return deadline > rhs.deadline; }
         
+        int64_t deadline; // in integer nanoseconds of the timer's clock
+        const SnapshotEntry *snapshotEntry; // NOT a shared_ptr, such that the timer thread never ends up destroying a delegate
+    };
+    
+    typedef std::vector<ScheduleEntry> Schedule;
+    
+    Schedule                         schedule;          // under ScheduleBackend_Heap
+    TimerWheel<const SnapshotEntry*> scheduleWheel;     // under ScheduleBackend_Wheel
+    ScheduleBackend                  scheduleBackend;
+    DelegateSnapshot                *scheduledSnapshot; // the snapshot that the schedule was last rebuilt from
+    std::atomic<bool>                scheduleDirty;
+    std::mutex                       scheduleMutex;     // only guards the wait on 'scheduleCondition' (never held while pinging)
+    std::condition_variable          scheduleCondition;
+    
+    void MarkScheduleDirty();
+    void RebuildSchedule(DelegateSnapshot *snapshot);
+    void ClearSchedule(int64_t now);
+    void InsertSchedule(const ScheduleEntry &scheduleEntry);
+    bool PopDueSchedule(int64_t now, ScheduleEntry &scheduleEntry);
+    bool NextScheduleDeadline(int64_t &deadline);
+    static Delegate::SchedulePeriod CurrentPeriod(Delegate *timerDelegate);
+    static int64_t Deadline(Delegate *timerDelegate);
+    static void    AdvanceSchedule(Delegate *timerDelegate, int64_t firedDeadline, int64_t now);
+    
+    bool FireDue(Clock::TimePoint &nextDeadline);
+    
+    static int64_t Nanoseconds(const Clock::TimePoint &timePoint);
+    static Clock::TimePoint TimePoint(int64_t nanoseconds);
+    
+    // --- Clock
+    // NOTE: never changes, such that it is safe to read from any thread
+    std::shared_ptr<Clock> clock;
+    
+    // --- Wait strategy
+    // the timer thread sleeps (against an absolute deadline) until 'wakeMargin' ahead of the next deadline, and
+    // then spins out the remainder. 'wakeMargin' is learned from how late the OS actually wakes the thread, such
+    // that the spin only has to cover the OS's wake-up jitter rather than the whole wait
+    // NOTE: except on Windows, where the thread spins out every wait for a deadline (see WaitUntil())
+    std::chrono::nanoseconds wakeMargin;
+    double                   wakeOvershootAverage;   // in nanoseconds
+    double                   wakeOvershootDeviation; // in nanoseconds
+    
+    void WaitUntil(const Clock::TimePoint &deadline, bool spinTail);
+    void LearnWakeOvershoot(const std::chrono::nanoseconds &overshoot);
+    
+    // --- Statistics
+    // NOTE: the counters are atomic, rather than guarded by 'statisticsMutex', as the timer thread updates them on
+    //       every fire. 'statisticsMutex' only guards 'timerThreadStart', which is never touched by the timer thread
+    std::atomic<uint64_t> statisticsFires;
+    std::atomic<uint64_t> statisticsTotalLatenessNanoseconds;
+    std::atomic<uint64_t> statisticsMaxLatenessNanoseconds;
+    std::atomic<uint64_t> statisticsRunNanoseconds;
+    std::atomic<uint64_t> statisticsSleepNanoseconds;
+    std::atomic<uint64_t> statisticsSpinNanoseconds;
+    std::atomic<uint64_t> statisticsWakeMarginNanoseconds;
+    std::atomic<bool> dumpStatisticsOnStop;
+    std::chrono::steady_clock::time_point timerThreadStart; // always in real time, as are all of the thread's own statistics
+    std::mutex statisticsMutex;
+    
+    // --- Thread policy
+    ThreadPolicy       threadPolicy;
+    ThreadPolicyResult threadPolicyResult;
+    
+    ThreadPolicy DispatchThreadPolicy();
+    static void ApplyThreadPolicy(std::thread *thread, const ThreadPolicy &policy, ThreadPolicyResult &result);
+    static void PrefaultStack();
+    
+    // --- Dispatch
+    // under DispatchMode_Threaded, every delegate has a DispatchWorker for as long as it is in delegateSet and the timer
+    // is running. The timer thread Post()s each deadline that comes due to the delegate's worker, which then calls
+    // TimerPing() on a thread of its own. A worker whose delegate was fired for the last time (FireOnce()) is
+    // retired by the timer thread, which lets it ping what is still pending before it finishes. One whose delegate
+    // was removed is cancelled instead. Either way, it is only deleted once it has finished and no snapshot that the
+    // timer thread could still be using refers to it
+    class DispatchWorker
+    {
+    public:
+        DispatchWorker(HighPrecisionTimer *t, const DelegateSetValue &td) : timer(t), timerDelegate(td), thread(nullptr), running(false), finished(false) {}
+        ~DispatchWorker() { Stop(); }
+        
+        bool Start(const ThreadPolicy &policy);
+        bool Post(int64_t deadline); // false if the deadline was dropped instead
+        void Retire();               // pings whatever is still pending, then finishes
+        void Cancel();               // drops whatever is still pending, then finishes (w/o waiting on it to)
+        void Stop();                 // cancels, and joins the thread
+        bool Finished() { return finished; }
+        
+    private:
+        HighPrecisionTimer     *timer;
+        DelegateSetValue        timerDelegate;
+        std::thread            *thread;
+        std::mutex              mutex;
+        std::condition_variable condition;
+        RingBuffer<int64_t>     pendingDeadlines; // guarded by 'mutex'
+        bool                    running;          // guarded by 'mutex'
+        std::atomic<bool>       finished;
+        
+        static void DispatchThreadProc(DispatchWorker *dispatchWorker);
+    };
+    
+    typedef std::pair<DispatchWorker*, uint64_t> RetiredDispatchWorker; // and the first snapshot generation w/o it
+    typedef std::vector<RetiredDispatchWorker> RetiredDispatchWorkers;
+    
+    DispatchMode           dispatchMode;
+    bool                   dispatchWorkersRunning; // whether delegates get a DispatchWorker (from Start() through to Stop())
+    RetiredDispatchWorkers retiredDispatchWorkers; // guarded by 'delegateSetMutex'
+    
+    void StartDispatchWorker(const DelegateSetValue &timerDelegate);
+    void RetireDispatchWorker(Delegate *timerDelegate, bool cancel);
+    void ReapDispatchWorkers(bool all);
+    void Dispatch(const SnapshotEntry &snapshotEntry, int64_t deadline, const Clock::TimePoint &now);
+    void RecordPing(Delegate *timerDelegate, int64_t deadline, int64_t pinged);
+    void ResetStatistics();
+    void DumpStatistics();
+    
     std::thread *timerThread;
-    bool timerThreadRunning;
+    std::atomic<bool> timerThreadRunning;
     std::mutex timerMutex;
     
     static void TimerThreadProc(HighPrecisionTimer *highPrecisionTimer);
@@ -0,0 +1,173 @@
+// ****************************************************************************
+// MIT License
+//
+// Copyright (c) 2019 Joshua E Bodinet
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// ****************************************************************************
+
+#ifndef LatenessHistogram_h
+#define LatenessHistogram_h
+
+#include <atomic>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cmath>
+
+// Fixed-memory, log-linear histogram of nanosecond durations. Each power of two is split into
+// 'subBucketCount' linear buckets, such that any value is recorded to within 1/16th (~6%) of
+// itself, from 1ns on up to ~4 seconds (anything longer lands in the last bucket, though the max
+// is still exact). Record() is lock free and never touches the heap, so it may be called from a
+// realtime thread, and Summarize() may be called from any thread, at any time, while recording
+// carries on
+// NOTE: buckets are 32 bits, to keep the histogram to ~2KB, so a single bucket wraps after 2^32
+//       records (~50 days of a 1kHz delegate that is always exactly as late)
+class LatenessHistogram
+{
+public:
+    class Summary
+    {
+    public:
+        Summary() : count(0), p50Nanoseconds(0), p99Nanoseconds(0), p999Nanoseconds(0), maxNanoseconds(0) {}
+        
+        uint64_t count;
+        uint64_t p50Nanoseconds;  // NOTE: percentiles are the upper bound of the bucket that they land in
+        uint64_t p99Nanoseconds;
+        uint64_t p999Nanoseconds;
+        uint64_t maxNanoseconds;  // exact
+    };
+    
+    LatenessHistogram() { Reset(); }
+    
+    void Record(uint64_t nanoseconds)
+    {
+        buckets[BucketIndex(nanoseconds)].fetch_add(1, std::memory_order_relaxed);
+        count.fetch_add(1, std::memory_order_relaxed);
+        
+        uint64_t max = maxNanoseconds.load(std::memory_order_relaxed);
+        while(nanoseconds > max && !maxNanoseconds.compare_exchange_weak(max, nanoseconds, std::memory_order_relaxed))
+        {
+            
+        }
+    }
+    
+    // NOTE: not atomic as a whole, so a Record() that races w/ it may or may not survive it
+    void Reset()
+    {
+        for(size_t i = 0; i < bucketCount; i++)
+        {
+            buckets[i].store(0, std::memory_order_relaxed);
+        }
+        
+        count.store(0, std::memory_order_relaxed);
+        maxNanoseconds.store(0, std::memory_order_relaxed);
+    }
+    
+    Summary Summarize() const
+    {
+        Summary summary;
+        uint64_t bucketCounts[bucketCount];
+        
+        // NOTE: the total is summed from the buckets themselves, rather than taken from 'count', such that
+        //       the percentiles are consistent w/ the very buckets that they are read from
+        for(size_t i = 0; i < bucketCount; i++)
+        {
+            bucketCounts[i] = buckets[i].load(std::memory_order_relaxed);
+            summary.count += bucketCounts[i];
+        }
+        
+        summary.maxNanoseconds = maxNanoseconds.load(std::memory_order_relaxed);
+        summary.p50Nanoseconds = std::min(ValueAtPercentile(bucketCounts, summary.count, 50.0), summary.maxNanoseconds);
+        summary.p99Nanoseconds = std::min(ValueAtPercentile(bucketCounts, summary.count, 99.0), summary.maxNanoseconds);
+        summary.p999Nanoseconds = std::min(ValueAtPercentile(bucketCounts, summary.count, 99.9), summary.maxNanoseconds);
+        
+        return summary;
+    }
+    
+    uint64_t Count() const { return count.load(std::memory_order_relaxed); }
+    
+private:
+    static const unsigned subBucketBits = 4;
+    static const size_t   subBucketCount = 1 << subBucketBits;
+    static const unsigned maxBits = 32; // 2^32ns, ~4 seconds
+    static const size_t   bucketCount = (maxBits - subBucketBits + 2) * subBucketCount;
+    
+    std::atomic<uint32_t> buckets[bucketCount];
+    std::atomic<uint64_t> count;
+    std::atomic<uint64_t> maxNanoseconds;
+    
+    // values below subBucketCount map 1:1 onto the first buckets, and every power of two from there on
+    // up gets subBucketCount buckets of its own, each 2^shift wide
+    static size_t BucketIndex(uint64_t value)
+    {
+        if(value < subBucketCount)
+        {
+            return (size_t)value;
+        }
+        
+        unsigned msb = 63;
+        while((value >> msb) == 0)
+        {
+            msb--;
+        }
+        
+        unsigned shift = msb - subBucketBits;
+        size_t index = (shift + 1) * subBucketCount + (size_t)((value >> shift) - subBucketCount);
+        
+        return std::min(index, bucketCount - 1);
+    }
+    
+    static uint64_t BucketUpperBound(size_t index)
+    {
+        if(index < subBucketCount)
+        {
+            return index;
+        }
+        
+        unsigned shift = (unsigned)(index / subBucketCount) - 1;
+        uint64_t subBucket = subBucketCount + (index % subBucketCount);
+        
+        return ((subBucket + 1) << shift) - 1;
+    }
+    
+    static uint64_t ValueAtPercentile(const uint64_t *bucketCounts, uint64_t total, double percentile)
+    {
+        if(total == 0)
+        {
+            return 0;
+        }
+        
+        uint64_t target = std::max((uint64_t)std::ceil(total * (percentile / 100.0)), (uint64_t)1);
+        uint64_t cumulative = 0;
+        
+        for(size_t i = 0; i < bucketCount; i++)
+        {
+            cumulative += bucketCounts[i];
+            if(cumulative >= target)
+            {
+                return BucketUpperBound(i);
+            }
+        }
+        
+        return BucketUpperBound(bucketCount - 1);
+    }
+};
+
+#endif /* LatenessHistogram_h */
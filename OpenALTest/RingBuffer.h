@@ -0,0 +1,308 @@
+// ****************************************************************************
+// MIT License
+//
+// Copyright (c) 2019 Joshua E Bodinet
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// ****************************************************************************
+
+
+#ifndef RingBuffer_h
+#define RingBuffer_h
+
+#include <vector>
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// Fixed-capacity FIFO. All storage is allocated up front by Allocate(), after
+// which Push(), PopFront() and Remove() never touch the heap. NOT thread safe.
+template<class T>
+class RingBuffer
+{
+public:
+    RingBuffer() : head(0), count(0) {}
+    
+    bool Allocate(size_t capacity)
+    {
+        if(capacity == 0)
+        {
+            return false;
+        }
+        
+        storage.clear();
+        storage.resize(capacity);
+        head = 0;
+        count = 0;
+        
+        return true;
+    }
+    
+    void Release()
+    {
+        std::vector<T>().swap(storage);
+        head = 0;
+        count = 0;
+    }
+    
+    bool Push(const T &value)
+    {
+        if(Full())
+        {
+            return false;
+        }
+        
+        storage[Index(count)] = value;
+        count++;
+        
+        return true;
+    }
+    
+    T &Front() { return storage[head]; }
+    
+    void PopFront()
+    {
+        if(count == 0)
+        {
+            return;
+        }
+        
+        head = Index(1);
+        count--;
+    }
+    
+    // i-th element counting from the front (0 == Front())
+    T &At(size_t i) { return storage[Index(i)]; }
+    
+    // removes the i-th element counting from the front, preserving the order of the remaining elements
+    void Remove(size_t i)
+    {
+        if(i >= count)
+        {
+            return;
+        }
+        
+        for(size_t j = i; j + 1 < count; j++)
+        {
+            storage[Index(j)] = storage[Index(j + 1)];
+        }
+        
+        count--;
+    }
+    
+    void Clear() { head = 0; count = 0; }
+    
+    size_t Size() const { return count; }
+    size_t Capacity() const { return storage.size(); }
+    size_t Available() const { return storage.size() - count; }
+    bool   Empty() const { return count == 0; }
+    bool   Full() const { return count == storage.size(); }
+    
+private:
+    std::vector<T> storage;
+    size_t head;
+    size_t count;
+    
+    size_t Index(size_t i) const { size_t index = head + i; return index < storage.size() ? index : index - storage.size(); }
+};
+
+// Single-producer / single-consumer byte FIFO. Write() may only ever be called from one
+// thread and Read() from one (other) thread; neither blocks, locks or touches the heap,
+// which makes it safe to Read() from within a realtime audio callback
+class LockFreeByteRing
+{
+public:
+    LockFreeByteRing() : writePosition(0), readPosition(0) {}
+    
+    bool Allocate(size_t capacity)
+    {
+        if(capacity == 0)
+        {
+            return false;
+        }
+        
+        storage.clear();
+        storage.resize(capacity);
+        Reset();
+        
+        return true;
+    }
+    
+    void Release()
+    {
+        std::vector<uint8_t>().swap(storage);
+        Reset();
+    }
+    
+    // NOTE: only valid while neither the producer nor the consumer is active
+    void Reset()
+    {
+        writePosition.store(0, std::memory_order_relaxed);
+        readPosition.store(0, std::memory_order_relaxed);
+    }
+    
+    // producer side -- writes all of 'size' bytes or nothing at all
+    bool Write(const void *data, size_t size)
+    {
+        uint64_t write = writePosition.load(std::memory_order_relaxed);
+        uint64_t read = readPosition.load(std::memory_order_acquire);
+        
+        if(size > storage.size() - (size_t)(write - read))
+        {
+            return false;
+        }
+        
+        Copy(&storage[0], (size_t)(write % storage.size()), (const uint8_t*)data, size);
+        writePosition.store(write + size, std::memory_order_release);
+        
+        return true;
+    }
+    
+    // consumer side -- returns the number of bytes actually read
+    size_t Read(void *data, size_t size)
+    {
+        uint64_t read = readPosition.load(std::memory_order_relaxed);
+        uint64_t write = writePosition.load(std::memory_order_acquire);
+        size_t   available = (size_t)(write - read);
+        
+        if(size > available)
+        {
+            size = available;
+        }
+        
+        size_t offset = (size_t)(read % storage.size());
+        size_t firstPart = std::min(size, storage.size() - offset);
+        
+        memcpy(data, &storage[offset], firstPart);
+        memcpy((uint8_t*)data + firstPart, &storage[0], size - firstPart);
+        readPosition.store(read + size, std::memory_order_release);
+        
+        return size;
+    }
+    
+    size_t ReadAvailable() const { return (size_t)(writePosition.load(std::memory_order_acquire) - readPosition.load(std::memory_order_acquire)); }
+    size_t WriteAvailable() const { return storage.size() - ReadAvailable(); }
+    size_t Capacity() const { return storage.size(); }
+    
+    // total number of bytes ever written / read since the last Reset()
+    uint64_t BytesWritten() const { return writePosition.load(std::memory_order_acquire); }
+    uint64_t BytesRead() const { return readPosition.load(std::memory_order_acquire); }
+    
+private:
+    std::vector<uint8_t>  storage;
+    std::atomic<uint64_t> writePosition; // monotonic, only ever advanced by the producer
+    std::atomic<uint64_t> readPosition;  // monotonic, only ever advanced by the consumer
+    
+    void Copy(uint8_t *dst, size_t offset, const uint8_t *src, size_t size)
+    {
+        size_t firstPart = std::min(size, storage.size() - offset);
+        
+        memcpy(dst + offset, src, firstPart);
+        memcpy(dst, src + firstPart, size - firstPart);
+    }
+};
+
+// Single-producer / single-consumer FIFO of T, w/ the same threading rules as LockFreeByteRing.
+// The consumer may peek at Front() and leave it in place until it is able to deal with it
+template<class T>
+class LockFreeRingBuffer
+{
+public:
+    LockFreeRingBuffer() : writeIndex(0), readIndex(0) {}
+    
+    bool Allocate(size_t capacity)
+    {
+        if(capacity == 0)
+        {
+            return false;
+        }
+        
+        storage.clear();
+        storage.resize(capacity);
+        writeIndex.store(0, std::memory_order_relaxed);
+        readIndex.store(0, std::memory_order_relaxed);
+        
+        return true;
+    }
+    
+    void Release()
+    {
+        std::vector<T>().swap(storage);
+        writeIndex.store(0, std::memory_order_relaxed);
+        readIndex.store(0, std::memory_order_relaxed);
+    }
+    
+    // producer side
+    bool Push(const T &value)
+    {
+        uint64_t write = writeIndex.load(std::memory_order_relaxed);
+        
+        if(write - readIndex.load(std::memory_order_acquire) >= storage.size())
+        {
+            return false;
+        }
+        
+        storage[(size_t)(write % storage.size())] = value;
+        writeIndex.store(write + 1, std::memory_order_release);
+        
+        return true;
+    }
+    
+    // consumer side -- nullptr if empty
+    T *Front()
+    {
+        uint64_t read = readIndex.load(std::memory_order_relaxed);
+        
+        if(read == writeIndex.load(std::memory_order_acquire))
+        {
+            return nullptr;
+        }
+        
+        return &storage[(size_t)(read % storage.size())];
+    }
+    
+    // consumer side -- the i-th element counting from Front(), nullptr if there are not that many
+    T *Peek(size_t i)
+    {
+        uint64_t read = readIndex.load(std::memory_order_relaxed);
+        
+        if(i >= (size_t)(writeIndex.load(std::memory_order_acquire) - read))
+        {
+            return nullptr;
+        }
+        
+        return &storage[(size_t)((read + i) % storage.size())];
+    }
+    
+    // consumer side -- only valid after Front() has returned an element
+    void PopFront() { readIndex.store(readIndex.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+    
+    size_t Size() const { return (size_t)(writeIndex.load(std::memory_order_acquire) - readIndex.load(std::memory_order_acquire)); }
+    size_t Capacity() const { return storage.size(); }
+    bool   Empty() const { return Size() == 0; }
+    
+private:
+    std::vector<T>        storage;
+    std::atomic<uint64_t> writeIndex; // monotonic, only ever advanced by the producer
+    std::atomic<uint64_t> readIndex;  // monotonic, only ever advanced by the consumer
+};
+
+#endif /* RingBuffer_h */
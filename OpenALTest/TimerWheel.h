@@ -0,0 +1,386 @@
+// ****************************************************************************
+// MIT License
+//
+// Copyright (c) 2019 Joshua E Bodinet
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// ****************************************************************************
+
+#ifndef TimerWheel_h
+#define TimerWheel_h
+
+#include <vector>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// Hierarchical timing wheel (after Varghese & Lauck) of values keyed by deadline, in integer
+// nanoseconds. Level 0 has a slot for each of the next 256 ticks (of 2^tickShift ns), and every
+// level above it a slot for each of the next 64 spans of the level below, out to ~73 minutes
+// (anything further out waits in the last slot, and is put back in place as it cascades down).
+// Insert() is O(1), as is expiring a value (amortized over the cascades that bring it down to
+// level 0), and NextDeadline() only ever looks at one slot per level, as every slot keeps track of
+// the earliest deadline in it. Values due within the same tick come due together, in no particular
+// order. Nodes are pooled, so once the pool has grown to the most values ever held (or Reserve()
+// has been called), nothing touches the heap. NOT thread safe
+template<class T>
+class TimerWheel
+{
+public:
+    TimerWheel() : currentTick(0), count(0), freeNodes(-1), dueNodes(-1) { Clear(0); }
+    
+    void Reserve(size_t capacity) { nodes.reserve(capacity); }
+    
+    // empties the wheel, and starts it over at 'now'
+    void Clear(int64_t now)
+    {
+        nodes.clear();
+        freeNodes = -1;
+        dueNodes = -1;
+        count = 0;
+        currentTick = Tick(now);
+        
+        for(size_t i = 0; i < slotCount; i++)
+        {
+            slotHeads[i] = -1;
+            slotEarliest[i] = std::numeric_limits<int64_t>::max();
+        }
+        
+        for(size_t i = 0; i < slotCount / 64; i++)
+        {
+            occupied[i] = 0;
+        }
+    }
+    
+    void Insert(int64_t deadline, const T &value)
+    {
+        int32_t node = AllocateNode();
+        nodes[node].deadline = deadline;
+        nodes[node].value = value;
+        
+        Place(node);
+        count++;
+    }
+    
+    // pops a value whose deadline is at or before 'now', if there is one
+    bool PopDue(int64_t now, int64_t &deadline, T &value)
+    {
+        if(dueNodes < 0)
+        {
+            Advance(now);
+            
+            if(dueNodes < 0)
+            {
+                return false;
+            }
+        }
+        
+        int32_t node = dueNodes;
+        dueNodes = nodes[node].next;
+        deadline = nodes[node].deadline;
+        value = nodes[node].value;
+        
+        FreeNode(node);
+        count--;
+        
+        return true;
+    }
+    
+    // the earliest deadline in the wheel, or false if it is empty
+    bool NextDeadline(int64_t &deadline) const
+    {
+        if(count == 0)
+        {
+            return false;
+        }
+        
+        int64_t earliest = std::numeric_limits<int64_t>::max();
+        
+        for(int32_t node = dueNodes; node >= 0; node = nodes[node].next)
+        {
+            earliest = std::min(earliest, nodes[node].deadline);
+        }
+        
+        // every level's slots come due in order, starting from the current tick's (level 0), or from the one
+        // after the current span's (every level above, whose current slot has already been cascaded down)
+        for(unsigned level = 0; level < levelCount; level++)
+        {
+            size_t start = level == 0 ? (size_t)(currentTick & (level0Slots - 1)) : (size_t)(((currentTick >> Shift(level)) + 1) & (levelSlots - 1));
+            int32_t slot = FindSlotFrom(level, start);
+            
+            if(slot >= 0)
+            {
+                earliest = std::min(earliest, slotEarliest[slot]);
+            }
+        }
+        
+        deadline = earliest;
+        
+        return true;
+    }
+    
+    size_t Size() const { return count; }
+    bool   Empty() const { return count == 0; }
+    
+private:
+    static const unsigned tickShift = 10;  // ~1us ticks
+    static const unsigned level0Bits = 8;
+    static const unsigned levelBits = 6;
+    static const unsigned levelCount = 5;  // 2^(8 + (6 * 4)) ticks, ~73 minutes
+    static const size_t   level0Slots = 1 << level0Bits;
+    static const size_t   levelSlots = 1 << levelBits;
+    static const size_t   slotCount = level0Slots + (levelCount - 1) * levelSlots;
+    
+    class Node
+    {
+    public:
+        Node() : deadline(0), next(-1) {}
+        
+        int64_t deadline;
+        T       value;
+        int32_t next;
+    };
+    
+    std::vector<Node> nodes;
+    int64_t  currentTick; // every tick before this one has been expired
+    size_t   count;
+    int32_t  freeNodes;
+    int32_t  dueNodes;    // expired, but yet to be popped
+    int32_t  slotHeads[slotCount];
+    int64_t  slotEarliest[slotCount];
+    uint64_t occupied[slotCount / 64]; // a bit for each slot that is not empty
+    
+    static int64_t  Tick(int64_t nanoseconds) { return nanoseconds >> tickShift; }
+    static unsigned Shift(unsigned level) { return level == 0 ? 0 : level0Bits + (level - 1) * levelBits; }
+    static size_t   FirstSlot(unsigned level) { return level == 0 ? 0 : level0Slots + (level - 1) * levelSlots; }
+    static size_t   SlotsIn(unsigned level) { return level == 0 ? level0Slots : levelSlots; }
+    
+    // the index of the lowest set bit ('bits' must not be 0)
+    static unsigned LowestSetBit(uint64_t bits)
+    {
+#if defined(__GNUC__) || defined(__clang__)
+        return (unsigned)__builtin_ctzll(bits);
+#elif defined(_MSC_VER) && defined(_WIN64)
+        unsigned long index;
+        _BitScanForward64(&index, bits);
+        return (unsigned)index;
+#else
+        unsigned index = 0;
+        while((bits & 1) == 0)
+        {
+            bits >>= 1;
+            index++;
+        }
+        return index;
+#endif
+    }
+    
+    int32_t AllocateNode()
+    {
+        if(freeNodes >= 0)
+        {
+            int32_t node = freeNodes;
+            freeNodes = nodes[node].next;
+            
+            return node;
+        }
+        
+        nodes.push_back(Node());
+        
+        return (int32_t)(nodes.size() - 1);
+    }
+    
+    void FreeNode(int32_t node)
+    {
+        nodes[node].next = freeNodes;
+        freeNodes = node;
+    }
+    
+    void Place(int32_t node)
+    {
+        int64_t tick = std::max(Tick(nodes[node].deadline), currentTick); // already due goes in the current tick
+        int64_t delta = tick - currentTick;
+        unsigned level = 0;
+        
+        while(level + 1 < levelCount && delta >= ((int64_t)1 << Shift(level + 1)))
+        {
+            level++;
+        }
+        
+        if(delta >= ((int64_t)1 << (Shift(levelCount - 1) + levelBits)))
+        {
+            tick = currentTick + ((int64_t)1 << (Shift(levelCount - 1) + levelBits)) - 1;
+        }
+        
+        size_t slot = FirstSlot(level) + (size_t)((tick >> Shift(level)) & (SlotsIn(level) - 1));
+        
+        nodes[node].next = slotHeads[slot];
+        slotHeads[slot] = node;
+        slotEarliest[slot] = std::min(slotEarliest[slot], nodes[node].deadline);
+        occupied[slot / 64] |= (uint64_t)1 << (slot % 64);
+    }
+    
+    // takes the whole of a slot out of the wheel, and returns its list of nodes
+    int32_t Detach(size_t slot)
+    {
+        int32_t node = slotHeads[slot];
+        
+        slotHeads[slot] = -1;
+        slotEarliest[slot] = std::numeric_limits<int64_t>::max();
+        occupied[slot / 64] &= ~((uint64_t)1 << (slot % 64));
+        
+        return node;
+    }
+    
+    // moves every node in the slot whose deadline is at or before 'limit' onto the due list
+    void Expire(size_t slot, int64_t limit)
+    {
+        int32_t node = Detach(slot);
+        
+        while(node >= 0)
+        {
+            int32_t next = nodes[node].next;
+            
+            if(nodes[node].deadline <= limit)
+            {
+                nodes[node].next = dueNodes;
+                dueNodes = node;
+            }
+            else
+            {
+                nodes[node].next = slotHeads[slot];
+                slotHeads[slot] = node;
+                slotEarliest[slot] = std::min(slotEarliest[slot], nodes[node].deadline);
+                occupied[slot / 64] |= (uint64_t)1 << (slot % 64);
+            }
+            
+            node = next;
+        }
+    }
+    
+    // puts every node of the slot back in place, one level down (or further)
+    void Cascade(size_t slot)
+    {
+        int32_t node = Detach(slot);
+        
+        while(node >= 0)
+        {
+            int32_t next = nodes[node].next;
+            Place(node);
+            node = next;
+        }
+    }
+    
+    void Advance(int64_t now)
+    {
+        int64_t nowTick = Tick(now);
+        
+        if(count == 0)
+        {
+            currentTick = std::max(currentTick, nowTick);
+            return;
+        }
+        
+        // every tick before now's is due as a whole. Empty slots are skipped over a word of 'occupied' at a
+        // time, so catching up costs O(1) per span of level 0 rather than per tick
+        while(currentTick < nowTick)
+        {
+            int64_t lastTick = std::min(nowTick - 1, currentTick | (int64_t)(level0Slots - 1));
+            size_t  first = (size_t)(currentTick & (level0Slots - 1));
+            size_t  last = (size_t)(lastTick & (level0Slots - 1));
+            int32_t slot;
+            
+            while(first <= last && (slot = FindSlot(first, last)) >= 0)
+            {
+                Expire((size_t)slot, std::numeric_limits<int64_t>::max());
+                first = (size_t)slot + 1;
+            }
+            
+            currentTick = lastTick + 1;
+            
+            // on to the next span of level 0, so bring down whatever is due within it from the level above (and
+            // so on up, for each level whose span has just turned over as well)
+            if((currentTick & (level0Slots - 1)) == 0)
+            {
+                for(unsigned level = 1; level < levelCount; level++)
+                {
+                    size_t index = (size_t)((currentTick >> Shift(level)) & (levelSlots - 1));
+                    Cascade(FirstSlot(level) + index);
+                    
+                    if(index != 0)
+                    {
+                        break;
+                    }
+                }
+            }
+        }
+        
+        // of now's own tick, only whatever is at or before now is due
+        size_t slot = (size_t)(currentTick & (level0Slots - 1));
+        if(slotEarliest[slot] <= now)
+        {
+            Expire(slot, now);
+        }
+    }
+    
+    // the first occupied slot in [first, last] (both absolute slot indices), or -1
+    int32_t FindSlot(size_t first, size_t last) const
+    {
+        while(first <= last)
+        {
+            size_t   word = first / 64;
+            size_t   wordLast = (word * 64) + 63;
+            uint64_t bits = occupied[word] & (~(uint64_t)0 << (first % 64));
+            
+            if(last < wordLast)
+            {
+                bits &= ~(uint64_t)0 >> (wordLast - last);
+            }
+            
+            if(bits != 0)
+            {
+                return (int32_t)((word * 64) + LowestSetBit(bits));
+            }
+            
+            first = wordLast + 1;
+        }
+        
+        return -1;
+    }
+    
+    // the first occupied slot of the level, going around from 'start'
+    int32_t FindSlotFrom(unsigned level, size_t start) const
+    {
+        size_t  firstSlot = FirstSlot(level);
+        int32_t slot = FindSlot(firstSlot + start, firstSlot + SlotsIn(level) - 1);
+        
+        if(slot < 0 && start > 0)
+        {
+            slot = FindSlot(firstSlot, firstSlot + start - 1);
+        }
+        
+        return slot;
+    }
+};
+
+#endif /* TimerWheel_h */
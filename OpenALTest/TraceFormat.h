@@ -0,0 +1,90 @@
+// ****************************************************************************
+// MIT License
+//
+// Copyright (c) 2019 Joshua E Bodinet
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// ****************************************************************************
+
+#ifndef TraceFormat_h
+#define TraceFormat_h
+
+#include <cstdint>
+#include <cstring>
+
+// Binary per-frame timing trace, as written by AudiblizerTestHarness (see SetTraceFile()) and turned
+// into text / CSV / summary statistics, well away from the machine under test, by Tools/TraceFormatter.
+//
+// A trace file is a single TraceFileHeader followed by nothing but TraceRecords, one per pumped video
+// frame, so a trace of N frames is always exactly sizeof(TraceFileHeader) + N * sizeof(TraceRecord)
+// bytes, and a truncated trace (e.g. from a crashed run) loses only its last partial record.
+//
+// NOTE: both structs are written as-is, in the byte order of the machine that wrote them, which
+//       'byteOrderMark' records. Fields are laid out largest-alignment-first so as to leave no padding
+namespace TraceFormat
+{
+    static const char     Magic[8] = { 'O', 'A', 'L', 'T', 'R', 'A', 'C', 'E' };
+    static const uint32_t Version = 2; // 2: deltaSeconds / totalSeconds widened to double
+    static const uint32_t ByteOrderMark = 0x01020304;
+    
+    enum RecordFlags
+    {
+        RecordFlag_SenderAudioUnqueuer = 1 << 0, // otherwise the video timer pumped the frame
+        RecordFlag_VideoFrameHiccup    = 1 << 1, // the frame did not follow on from the previous one
+        RecordFlag_AVDrift             = 1 << 2, // audio and video were more than a frame apart
+    };
+    
+    class TraceFileHeader
+    {
+    public:
+        TraceFileHeader() : version(Version), byteOrderMark(ByteOrderMark), headerSize(sizeof(TraceFileHeader)), recordSize(0),
+                            audioChunkCacheSize(1), reserved(0), totalNumFrames(0), adversarialTestingAudioPlayrateFactor(1.0)
+        {
+            memcpy(magic, Magic, sizeof(magic));
+        }
+        
+        char     magic[8];
+        uint32_t version;
+        uint32_t byteOrderMark;
+        uint32_t headerSize;
+        uint32_t recordSize;
+        uint32_t audioChunkCacheSize; // the adversarial audio chunk cache size of the test (1 if none)
+        uint32_t reserved;
+        uint64_t totalNumFrames;      // how many video frames the test was to play
+        double   adversarialTestingAudioPlayrateFactor;
+    };
+    
+    class TraceRecord
+    {
+    public:
+        int64_t  avEqualizer;
+        int64_t  audioChunkIter;
+        int64_t  videoFrameIter;
+        double   audioPositionSeconds;
+        double   deltaSeconds;          // since the previous pump
+        double   totalSeconds;          // since the first pump
+        uint32_t adversarialTestingAudioChunkCacheAccum;
+        uint32_t flags;                 // RecordFlags
+    };
+    
+    static_assert(sizeof(TraceFileHeader) == 48, "TraceFileHeader must be free of padding");
+    static_assert(sizeof(TraceRecord) == 56, "TraceRecord must be free of padding");
+}
+
+#endif /* TraceFormat_h */
@@ -26,6 +26,7 @@
 #define VideoTimerDelegate_h
 
 #include <iostream>
+#include <mutex>
 
 #include "HighPrecisionTimer.h"
 
@@ -42,24 +43,33 @@ public:
         virtual void VideoTimerPing() = 0;
     };
     
-    VideoTimerDelegate() { timerPingListener = nullptr; timerPeriod = 1001.0 / 30000.0; audioPlayrateFactor = 1.0; }
+    VideoTimerDelegate() { timerPingListener = nullptr; timerPeriodSampleDuration = 1001; timerPeriodTimeScale = 30000; timerPeriod = 1001.0 / 30000.0; audioPlayrateFactor = 1.0; }
     virtual ~VideoTimerDelegate() { }
     
     virtual void SetTimerPingListener(std::shared_ptr<TimerPingListener> listener) { timerPingListener = listener; }
     virtual void PrepareForDestruction() { timerPingListener = nullptr; }
     
-    virtual void SetTimerPeriod(double period) { if(period > 0) timerPeriod = period; }
-    virtual void SetAudioPlayrateFactor(double factor) { if(factor > 0) audioPlayrateFactor = factor; }
+    // NOTE: may be called from any thread (e.g. an audio completion), while the timer thread reads the period
+    //       after every ping, hence 'periodMutex'. ScheduleChanged() is called outside of it
+    virtual void SetTimerPeriod(double period) { if(period > 0) { { std::lock_guard<std::mutex> lock(periodMutex); timerPeriodSampleDuration = 0; timerPeriodTimeScale = 0; timerPeriod = period; } ScheduleChanged(); } }
+    virtual void SetTimerPeriod(uint64_t sampleDuration, uint64_t timeScale) { if(sampleDuration > 0 && timeScale > 0) { { std::lock_guard<std::mutex> lock(periodMutex); timerPeriodSampleDuration = sampleDuration; timerPeriodTimeScale = timeScale; timerPeriod = sampleDuration / (double)timeScale; } ScheduleChanged(); } }
+    virtual void SetAudioPlayrateFactor(double factor) { if(factor > 0) { { std::lock_guard<std::mutex> lock(periodMutex); audioPlayrateFactor = factor; } ScheduleChanged(); } }
     
     // HighPrecisionTimer::Delegate Interface
     // ------------------------------------------------------------------
     virtual void TimerPing() { if(timerPingListener != nullptr) timerPingListener->VideoTimerPing(); }
-    virtual double TimerPeriod() { return timerPeriod * audioPlayrateFactor; }
+    virtual double TimerPeriod() { std::lock_guard<std::mutex> lock(periodMutex); return timerPeriod * audioPlayrateFactor; }
+    virtual double TimerPeriodExact(uint64_t &numerator, uint64_t &timeScale) { std::lock_guard<std::mutex> lock(periodMutex); bool exact = timerPeriodTimeScale != 0 && audioPlayrateFactor == 1.0; numerator = exact ? timerPeriodSampleDuration : 0; timeScale = exact ? timerPeriodTimeScale : 0; return timerPeriod * audioPlayrateFactor; } // frame N is due at exactly N * sampleDuration / timeScale (unless the playrate has been adjusted)
     virtual bool FireOnce() { return false; }
+    virtual MissedDeadlinePolicy MissedDeadlines() { return MissedDeadlinePolicy_CatchUp; } // every frame gets pumped, even when late
+    virtual const char* TimerDelegateName() { return "video"; }
     
 private:
+    uint64_t timerPeriodSampleDuration; // the exact period, when known (0 otherwise)
+    uint64_t timerPeriodTimeScale;
     double timerPeriod;
     double audioPlayrateFactor;
+    std::mutex periodMutex; // guards the four fields above, such that the timer never sees half of a new period
     std::shared_ptr<TimerPingListener> timerPingListener;
 };
 
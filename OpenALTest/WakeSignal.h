@@ -0,0 +1,169 @@
+// ****************************************************************************
+// MIT License
+//
+// Copyright (c) 2019 Joshua E Bodinet
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// ****************************************************************************
+
+#ifndef WakeSignal_h
+#define WakeSignal_h
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#if defined(__linux__)
+#include <sys/eventfd.h>
+#include <poll.h>
+#include <unistd.h>
+#elif defined(__APPLE__)
+#include <dispatch/dispatch.h>
+#else
+#include <mutex>
+#include <condition_variable>
+#endif
+
+// Wakes a single consumer thread that sleeps while there is nothing for it to do. Unlike Event, the
+// producer side never locks, blocks or allocates: Signal() is a single atomic load unless the consumer
+// is actually asleep, in which case it also costs a single write() to an eventfd (Linux), or a
+// dispatch semaphore signal (Apple). Which makes it safe to Signal() from a realtime thread.
+//
+// The consumer announces the wait before taking a last look for work, so that work that shows up in
+// between is never slept through:
+//
+//     wakeSignal.PrepareWait();
+//     if(nothing to do) { wakeSignal.Wait(timeout); } else { wakeSignal.CancelWait(); }
+//
+// NOTE: Wait() may return early (e.g. on a Signal() that raced a CancelWait()), so the consumer must
+//       always look for work again rather than assume that there is some
+class WakeSignal
+{
+public:
+    WakeSignal() : sleeping(false)
+    {
+#if defined(__linux__)
+        eventFD = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+#elif defined(__APPLE__)
+        semaphore = dispatch_semaphore_create(0);
+#else
+        posted = false;
+#endif
+    }
+    
+    ~WakeSignal()
+    {
+#if defined(__linux__)
+        if(eventFD >= 0)
+        {
+            close(eventFD);
+        }
+#elif defined(__APPLE__)
+        dispatch_release(semaphore);
+#endif
+    }
+    
+    WakeSignal(const WakeSignal&) = delete;
+    WakeSignal& operator=(const WakeSignal&) = delete;
+    
+    // producer side -- call after the work has been published
+    void Signal()
+    {
+        // NOTE: pairs w/ the fence in PrepareWait(), such that either this sees the consumer asleep, or
+        //       the consumer sees the work that was published before the call
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        
+        if(sleeping.load(std::memory_order_relaxed) && sleeping.exchange(false))
+        {
+            Post();
+        }
+    }
+    
+    // consumer side
+    void PrepareWait()
+    {
+        sleeping.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+    }
+    
+    void CancelWait() { sleeping.store(false); }
+    
+    template<class Rep, class Period>
+    void Wait(const std::chrono::duration<Rep, Period> &timeout)
+    {
+        int64_t timeoutNanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(timeout).count();
+        
+#if defined(__linux__)
+        struct pollfd pollFD;
+        pollFD.fd = eventFD;
+        pollFD.events = POLLIN;
+        pollFD.revents = 0;
+        
+        if(poll(&pollFD, 1, (int)((timeoutNanoseconds + 999999) / 1000000)) > 0)
+        {
+            uint64_t count;
+            ssize_t bytesRead = read(eventFD, &count, sizeof(count));
+            (void)bytesRead;
+        }
+#elif defined(__APPLE__)
+        dispatch_semaphore_wait(semaphore, dispatch_time(DISPATCH_TIME_NOW, timeoutNanoseconds));
+        
+        // soak up any further signals, so that they do not cut the next wait short
+        while(dispatch_semaphore_wait(semaphore, DISPATCH_TIME_NOW) == 0)
+        {
+            
+        }
+#else
+        std::unique_lock<std::mutex> lock(mutex);
+        condition.wait_for(lock, std::chrono::nanoseconds(timeoutNanoseconds), [this] { return posted; });
+        posted = false;
+#endif
+        
+        sleeping.store(false);
+    }
+    
+private:
+    std::atomic<bool> sleeping;
+    
+#if defined(__linux__)
+    int eventFD;
+#elif defined(__APPLE__)
+    dispatch_semaphore_t semaphore;
+#else
+    std::mutex              mutex;
+    std::condition_variable condition;
+    bool                    posted;
+#endif
+    
+    void Post()
+    {
+#if defined(__linux__)
+        uint64_t one = 1;
+        ssize_t bytesWritten = write(eventFD, &one, sizeof(one));
+        (void)bytesWritten;
+#elif defined(__APPLE__)
+        dispatch_semaphore_signal(semaphore);
+#else
+        std::lock_guard<std::mutex> lock(mutex);
+        posted = true;
+        condition.notify_one();
+#endif
+    }
+};
+
+#endif /* WakeSignal_h */
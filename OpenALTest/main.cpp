@@ -40,6 +40,18 @@ int main(int argc, const char * argv[])
     uint32_t audioChunkCacheSize;
     uint32_t numPressureThreads;
     bool multiframerate = true;
+    bool realtimeTimerThread = false;
+    bool threadedTimerDispatch = false;
+    double audioQueueDepthSeconds = 4.0;
+    std::string traceFilePath; // when set, per-frame timing goes to a binary trace (see Tools/TraceFormatter.cpp) instead of to text
+    int retVal = 0;
+    Audiblizer::Configuration audiblizerConfiguration;
+    
+    // PlaybackMode_Callback pulls audio via AL_SOFT_callback_buffer when available
+    audiblizerConfiguration.playbackMode = Audiblizer::PlaybackMode_Queued;
+    
+    // loopback renders headless (via ALC_SOFT_loopback) on a virtual clock, as fast as OpenAL is able to
+    audiblizerConfiguration.loopback = false;
     
     std::string sourceAudioFilePath = "/Users/josh/Desktop/04 Twisting By The Pool.m4a";
     //sourceAudioFilePath = "/Users/josh/Documents/Media/Video/Spherical/WindowsSample/SampleVideo.mp4";
@@ -68,12 +80,54 @@ int main(int argc, const char * argv[])
     
     // initialize test harness
     // ---------------------------------------
-    if(!audiblizerTestHarness->Initialize())
+    if(!audiblizerTestHarness->Initialize(audiblizerConfiguration))
     {
         printf("AudiblizerTestHarness Initialize Error!!!\n");
         goto Exit;
     }
     
+    // optionally run the timer thread realtime (opt-in on Linux), pinned to an isolated cpu
+    // ---------------------------------------
+    if(realtimeTimerThread)
+    {
+        HighPrecisionTimer::ThreadPolicy timerThreadPolicy;
+        timerThreadPolicy.realtime = true;
+        timerThreadPolicy.cpu = HighPrecisionTimer::FirstIsolatedCPU();
+        timerThreadPolicy.lockMemory = true;
+        
+        if(!audiblizerTestHarness->SetTimerThreadPolicy(timerThreadPolicy))
+        {
+            printf("AudiblizerTestHarness Failed to set timer thread policy!!!\n");
+        }
+    }
+    
+    // optionally ping each timer delegate from a thread of its own, so that one that blocks cannot hold up the other
+    // ---------------------------------------
+    if(threadedTimerDispatch)
+    {
+        if(!audiblizerTestHarness->SetTimerDispatchMode(HighPrecisionTimer::DispatchMode_Threaded))
+        {
+            printf("AudiblizerTestHarness Failed to set timer dispatch mode!!!\n");
+        }
+    }
+    
+    // how much audio to keep queued (the queueing thread is woken by completions, so 50 - 100 ms will do for low latency)
+    // ---------------------------------------
+    if(!audiblizerTestHarness->SetAudioQueueDepth(audioQueueDepthSeconds))
+    {
+        printf("AudiblizerTestHarness Failed to set audio queue depth!!!\n");
+    }
+    
+    // optionally trace per-frame timing to a binary file, to be formatted offline
+    // ---------------------------------------
+    if(!traceFilePath.empty())
+    {
+        if(!audiblizerTestHarness->SetTraceFile(traceFilePath.c_str()))
+        {
+            printf("AudiblizerTestHarness Failed to set trace file!!!\n");
+        }
+    }
+    
     // get some type of audio into the test harness
     // ---------------------------------------
     
@@ -132,6 +186,13 @@ int main(int argc, const char * argv[])
     // ---------------------------------------
     audiblizerTestHarness->StopTest();
     
+    // when built w/ AUDIBLIZER_TRACK_ALLOCATIONS=1, any heap activity on the timer path during steady-state playback fails the run
+    if(audiblizerTestHarness->SteadyStateAllocationsOccurred())
+    {
+        printf("ERROR: Audiblizer allocated on the timer path during steady-state playback!!!\n");
+        retVal = 1;
+    }
+    
 Exit:
-    return 0;
+    return retVal;
 }
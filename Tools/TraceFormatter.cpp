@@ -0,0 +1,307 @@
+// ****************************************************************************
+// MIT License
+//
+// Copyright (c) 2019 Joshua E Bodinet
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// ****************************************************************************
+
+// TraceFormatter: turns a binary per-frame timing trace, as written by AudiblizerTestHarness::SetTraceFile(),
+// into one of:
+//   --text     -- the very same lines that the harness prints when it is not tracing (the default)
+//   --csv      -- a row per frame, for a spreadsheet / plotting
+//   --summary  -- pump deltas (avg, percentiles, extremes), hiccups and drift over the whole trace
+//
+// Build & run (from this directory):
+//     c++ -std=c++14 -O2 -I../OpenALTest TraceFormatter.cpp -o TraceFormatter
+//     ./TraceFormatter [--text | --csv | --summary] trace.bin
+
+#include <cstdio>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <cmath>
+#include <algorithm>
+#include <vector>
+
+#include "TraceFormat.h"
+
+enum OutputFormat { OutputFormat_Text = 0, OutputFormat_CSV, OutputFormat_Summary };
+
+class TraceSummary
+{
+public:
+    TraceSummary() : numRecords(0), numAudioUnqueuerPumps(0), numHiccups(0), maxHiccup(0), maxHiccupVideoFrameIter(0),
+                     numDriftFrames(0), maxDrift(0), maxDriftVideoFrameIter(0), totalSeconds(0), finalAudioPositionSeconds(0) {}
+    
+    uint64_t           numRecords;
+    uint64_t           numAudioUnqueuerPumps;
+    uint64_t           numHiccups;
+    int64_t            maxHiccup;
+    int64_t            maxHiccupVideoFrameIter;
+    uint64_t           numDriftFrames;
+    int64_t            maxDrift;
+    int64_t            maxDriftVideoFrameIter;
+    double             totalSeconds;
+    double             finalAudioPositionSeconds;
+    std::vector<double> deltas;
+};
+
+static void OutputText(const TraceFormat::TraceFileHeader &header, const TraceFormat::TraceRecord &record)
+{
+    const char *sender = (record.flags & TraceFormat::RecordFlag_SenderAudioUnqueuer) ? "A" : "V";
+    const char *hiccup = (record.flags & TraceFormat::RecordFlag_VideoFrameHiccup) ? "*" : " ";
+    
+    if(header.audioChunkCacheSize == 1)
+    {
+        printf("Sender:%s   A/V Eq:%04lld   ACI:%06lld   VFI:%06lld%s  delta sec:%f   total sec:%f   audio sec:%f",
+               sender, (long long)record.avEqualizer, (long long)record.audioChunkIter, (long long)record.videoFrameIter, hiccup,
+               record.deltaSeconds, record.totalSeconds, record.audioPositionSeconds);
+    }
+    else
+    {
+        printf("Sender:%s   A/V Eq:%04lld   ACI:%06lld+%02d   VFI:%06lld%s  delta sec:%f   total sec:%f   audio sec:%f",
+               sender, (long long)record.avEqualizer, (long long)record.audioChunkIter, record.adversarialTestingAudioChunkCacheAccum, (long long)record.videoFrameIter, hiccup,
+               record.deltaSeconds, record.totalSeconds, record.audioPositionSeconds);
+    }
+    
+    printf("%s", (record.flags & TraceFormat::RecordFlag_AVDrift) ? "   *** DRIFT ***\n" : "\n");
+}
+
+static void OutputCSV(const TraceFormat::TraceRecord &record)
+{
+    printf("%s,%lld,%lld,%u,%lld,%f,%f,%f,%d,%d\n",
+           (record.flags & TraceFormat::RecordFlag_SenderAudioUnqueuer) ? "A" : "V",
+           (long long)record.avEqualizer,
+           (long long)record.audioChunkIter,
+           record.adversarialTestingAudioChunkCacheAccum,
+           (long long)record.videoFrameIter,
+           record.deltaSeconds,
+           record.totalSeconds,
+           record.audioPositionSeconds,
+           (record.flags & TraceFormat::RecordFlag_VideoFrameHiccup) ? 1 : 0,
+           (record.flags & TraceFormat::RecordFlag_AVDrift) ? 1 : 0);
+}
+
+static void AccumulateSummary(TraceSummary &summary, const TraceFormat::TraceRecord &record, int64_t lastVideoFrameIter)
+{
+    summary.numRecords++;
+    summary.deltas.push_back(record.deltaSeconds);
+    summary.totalSeconds = record.totalSeconds;
+    summary.finalAudioPositionSeconds = record.audioPositionSeconds;
+    
+    if(record.flags & TraceFormat::RecordFlag_SenderAudioUnqueuer)
+    {
+        summary.numAudioUnqueuerPumps++;
+    }
+    
+    if(record.flags & TraceFormat::RecordFlag_VideoFrameHiccup)
+    {
+        summary.numHiccups++;
+        if(record.videoFrameIter - lastVideoFrameIter > summary.maxHiccup)
+        {
+            summary.maxHiccup = record.videoFrameIter - lastVideoFrameIter;
+            summary.maxHiccupVideoFrameIter = record.videoFrameIter;
+        }
+    }
+    
+    if(record.flags & TraceFormat::RecordFlag_AVDrift)
+    {
+        int64_t drift = std::abs(record.audioChunkIter - record.videoFrameIter);
+        
+        summary.numDriftFrames++;
+        if(drift > summary.maxDrift)
+        {
+            summary.maxDrift = drift;
+            summary.maxDriftVideoFrameIter = record.videoFrameIter;
+        }
+    }
+}
+
+static double Percentile(const std::vector<double> &sorted, double percentile)
+{
+    if(sorted.empty())
+    {
+        return 0;
+    }
+    
+    return sorted[std::min(sorted.size() - 1, (size_t)(percentile / 100.0 * sorted.size()))];
+}
+
+static void OutputSummary(const TraceFormat::TraceFileHeader &header, TraceSummary &summary)
+{
+    double cumulativeDelta = 0;
+    
+    for(size_t i = 0; i < summary.deltas.size(); i++)
+    {
+        cumulativeDelta += summary.deltas[i];
+    }
+    
+    std::sort(summary.deltas.begin(), summary.deltas.end());
+    
+    printf("Records:%llu (of %llu video frames) - pumped by video timer:%llu audio unqueuer:%llu\n",
+           (unsigned long long)summary.numRecords, (unsigned long long)header.totalNumFrames,
+           (unsigned long long)(summary.numRecords - summary.numAudioUnqueuerPumps), (unsigned long long)summary.numAudioUnqueuerPumps);
+    printf("Adversarial AudioPlayrateFactor:%f AudioChunkCacheSize:%u\n", header.adversarialTestingAudioPlayrateFactor, header.audioChunkCacheSize);
+    printf("Total sec:%f - final audio sec:%f\n", summary.totalSeconds, summary.finalAudioPositionSeconds);
+    
+    if(!summary.deltas.empty())
+    {
+        printf("Delta sec avg:%f min:%f p50:%f p99:%f p99.9:%f max:%f\n",
+               cumulativeDelta / summary.deltas.size(), summary.deltas.front(),
+               Percentile(summary.deltas, 50.0), Percentile(summary.deltas, 99.0), Percentile(summary.deltas, 99.9), summary.deltas.back());
+    }
+    
+    if(summary.numHiccups != 0)
+    {
+        printf("*** VIDEO FRAME HICCUPS OCCURRED!!! NUM HICCUPS: %llu - MAX HICCUP: %lld VIDEO FRAMES AT VFI:%06lld ***\n",
+               (unsigned long long)summary.numHiccups, (long long)summary.maxHiccup, (long long)summary.maxHiccupVideoFrameIter);
+    }
+    else
+    {
+        printf("No video frame hiccups occurred\n");
+    }
+    
+    if(summary.numDriftFrames != 0)
+    {
+        printf("*** AUDIO/VIDEO DRIFT OCCURRED!!! MAX DRIFT: %lld VIDEO FRAMES AT VFI:%06lld - NUM FRAMES WITH DRIFT: %llu ***\n",
+               (long long)summary.maxDrift, (long long)summary.maxDriftVideoFrameIter, (unsigned long long)summary.numDriftFrames);
+    }
+    else
+    {
+        printf("No audio/video drift occurred\n");
+    }
+    
+    // NOTE: the first frame of a test is never pumped, so a complete trace is a record short of the frames
+    if(summary.numRecords + 1 < header.totalNumFrames)
+    {
+        printf("*** FRAMES MISSING FROM THE TRACE!!! NUM FRAMES: %llu ***\n", (unsigned long long)(header.totalNumFrames - 1 - summary.numRecords));
+    }
+}
+
+int main(int argc, const char * argv[])
+{
+    OutputFormat outputFormat = OutputFormat_Text;
+    const char *traceFilePath = nullptr;
+    FILE *traceFile = nullptr;
+    TraceFormat::TraceFileHeader header;
+    std::vector<TraceFormat::TraceRecord> records(4096);
+    TraceSummary summary;
+    int64_t lastVideoFrameIter = 0;
+    size_t numRecordsRead = 0;
+    int retVal = 1;
+    
+    for(int i = 1; i < argc; i++)
+    {
+        if(strcmp(argv[i], "--text") == 0)
+        {
+            outputFormat = OutputFormat_Text;
+        }
+        else if(strcmp(argv[i], "--csv") == 0)
+        {
+            outputFormat = OutputFormat_CSV;
+        }
+        else if(strcmp(argv[i], "--summary") == 0)
+        {
+            outputFormat = OutputFormat_Summary;
+        }
+        else if(argv[i][0] != '-' && traceFilePath == nullptr)
+        {
+            traceFilePath = argv[i];
+        }
+        else
+        {
+            traceFilePath = nullptr;
+            break;
+        }
+    }
+    
+    if(traceFilePath == nullptr)
+    {
+        printf("Usage: %s [--text | --csv | --summary] trace.bin\n", argv[0]);
+        goto Exit;
+    }
+    
+    traceFile = fopen(traceFilePath, "rb");
+    if(traceFile == nullptr)
+    {
+        printf("Failed to open trace file!!! Error:%s\n", strerror(errno));
+        goto Exit;
+    }
+    
+    if(fread(&header, sizeof(header), 1, traceFile) != 1 || memcmp(header.magic, TraceFormat::Magic, sizeof(header.magic)) != 0)
+    {
+        printf("ERROR: Not a trace file!!!\n");
+        goto Exit;
+    }
+    
+    if(header.byteOrderMark != TraceFormat::ByteOrderMark)
+    {
+        printf("ERROR: Trace file was written on a machine of the other byte order!!!\n");
+        goto Exit;
+    }
+    
+    if(header.version != TraceFormat::Version || header.headerSize != sizeof(header) || header.recordSize != sizeof(TraceFormat::TraceRecord))
+    {
+        printf("ERROR: Unsupported trace file version:%u!!!\n", header.version);
+        goto Exit;
+    }
+    
+    if(outputFormat == OutputFormat_CSV)
+    {
+        printf("sender,av_equalizer,audio_chunk_iter,audio_chunk_cache_accum,video_frame_iter,delta_sec,total_sec,audio_sec,hiccup,drift\n");
+    }
+    
+    while((numRecordsRead = fread(records.data(), sizeof(TraceFormat::TraceRecord), records.size(), traceFile)) != 0)
+    {
+        for(size_t i = 0; i < numRecordsRead; i++)
+        {
+            switch(outputFormat)
+            {
+                case OutputFormat_Text:    OutputText(header, records[i]); break;
+                case OutputFormat_CSV:     OutputCSV(records[i]); break;
+                case OutputFormat_Summary: AccumulateSummary(summary, records[i], lastVideoFrameIter); break;
+            }
+            
+            lastVideoFrameIter = records[i].videoFrameIter;
+        }
+    }
+    
+    if(ferror(traceFile))
+    {
+        printf("Failed to read trace file!!! Error:%s\n", strerror(errno));
+        goto Exit;
+    }
+    
+    if(outputFormat == OutputFormat_Summary)
+    {
+        OutputSummary(header, summary);
+    }
+    
+    retVal = 0;
+    
+Exit:
+    if(traceFile != nullptr)
+    {
+        fclose(traceFile);
+    }
+    
+    return retVal;
+}